@@ -10,6 +10,14 @@ CONFIG += c++11
 # deprecated API in order to know how to port your code away from it.
 DEFINES += QT_DEPRECATED_WARNINGS
 
+# Count every heap allocation, see physicalworld::StepAllocations
+CONFIG(debug, debug|release): DEFINES += WFPE_COUNT_ALLOCATIONS
+
+# Cloth::solveLinks is written for the auto vectorizer. GCC only takes it
+# with the vectorizer on at -O2 and sqrt free of errno, check with
+# -fopt-info-vec
+gcc|clang: QMAKE_CXXFLAGS_RELEASE += -ftree-vectorize -fno-math-errno
+
 # You can also make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -18,30 +26,54 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += \
     main.cpp \
     mainwindow.cpp \
+    physics/Asset/AssetCache.cpp \
     physics/Cloth/cloth.cpp \
+    physics/Cloth/projectivedynamics.cpp \
     physics/Collision/GJK.cpp \
     physics/Constraints/linkconstraints.cpp \
+    physics/algo/arena.cpp \
+    physics/algo/bvh.cpp \
     physics/algo/kdtree.cpp \
+    physics/algo/parallel.cpp \
+    physics/algo/quickhull.cpp \
+    physics/algo/spatialhash.cpp \
     physics/physicalworld.cpp \
     render/GLwindow.cpp
 
 HEADERS += \
     mainwindow.h \
+    physics/Asset/AssetCache.h \
     physics/Cloth/cloth.h \
+    physics/Cloth/projectivedynamics.h \
+    physics/Collision/Broadphase.h \
+    physics/Collision/CapsuleCollider.h \
     physics/Collision/Collider.h \
     physics/Collision/Collision.h \
     physics/Collision/CollisionObject.h \
     physics/Collision/CollisionPoints.h \
+    physics/Collision/CompoundCollider.h \
     physics/Collision/DetectCollisoin.h \
     physics/Collision/GJK.h \
+    physics/Collision/HeightfieldCollider.h \
     physics/Collision/HullCollider.h \
+    physics/Collision/MeshCollider.h \
+    physics/Collision/ObjectPool.h \
     physics/Collision/PlaneCollider.h \
+    physics/Collision/Query.h \
     physics/Collision/SphereCollider.h \
+    physics/Constraints/chainconstraint.h \
     physics/Constraints/linkconstraints.h \
     physics/Dynamic/ImpluseSolveer.h \
+    physics/Dynamic/MassProperties.h \
     physics/Dynamic/Solver.h \
     physics/Dynamic/smoothPositionSolver.h \
+    physics/algo/aabb.h \
+    physics/algo/arena.h \
+    physics/algo/bvh.h \
     physics/algo/kdtree.h \
+    physics/algo/parallel.h \
+    physics/algo/quickhull.h \
+    physics/algo/spatialhash.h \
     physics/physicalworld.h \
     render/GLwindow.h \
     render/qCamera.h
@@ -50,6 +82,19 @@ INCLUDEPATH += \
               .\include \
               .\include/eigen \
 
+# Model import goes through assimp, only its headers are vendored.
+# Build with CONFIG+=assimp to link it by hand, otherwise it is picked up
+# through pkg-config when installed. Without it AssetCache only loads
+# existing .wfpc caches.
+assimp {
+    DEFINES += WFPE_ASSIMP
+    LIBS += -lassimp
+} else: packagesExist(assimp) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += assimp
+    DEFINES += WFPE_ASSIMP
+}
+
 FORMS += \
     mainwindow.ui
 
@@ -0,0 +1,388 @@
+#include "AssetCache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#ifdef WFPE_ASSIMP
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#endif
+
+namespace physE {
+
+    namespace {
+
+        // bump whenever the layout of any section changes
+        const quint32 CacheVersion = 1;
+        const char CacheMagic[4] = {'W', 'F', 'P', 'C'};
+
+        enum CacheKind : quint32 {
+            KindHull = 1,
+            KindMesh = 2
+        };
+
+        enum SectionId : quint32 {
+            HullVertices,     // VerNorm, also the render vertex buffer
+            HullIndex,
+            HullFaces,
+            HullFaceVertices,
+            HullAdjOffset,
+            HullAdjacent,
+            MeshVertices,
+            MeshIndex,
+            MeshRender,       // VerNorm
+            BVHNodes,
+            BVHIndices
+        };
+
+        struct CacheHeader
+        {
+            char    Magic[4];
+            quint32 Version;
+            quint32 Kind;
+            qint32  Param;        // cook parameter, maxVertices for hulls
+            qint64  SourceSize;
+            qint64  SourceTime;   // ms since epoch
+            quint32 SectionCount;
+            quint32 Reserved;
+        };
+
+        struct CacheSection
+        {
+            quint32 Id;
+            quint32 ElementSize;
+            quint64 Offset;
+            quint64 Count;
+        };
+
+        const qint64 SectionAlign = 16;
+
+        qint64 Align(qint64 offset)
+        {
+            return (offset + SectionAlign - 1) & ~(SectionAlign - 1);
+        }
+
+        CacheHeader MakeHeader(const QFileInfo& source, CacheKind kind, int param)
+        {
+            CacheHeader header = {};
+            std::copy(CacheMagic, CacheMagic + 4, header.Magic);
+            header.Version = CacheVersion;
+            header.Kind = kind;
+            header.Param = param;
+            header.SourceSize = source.size();
+            header.SourceTime = source.lastModified().toMSecsSinceEpoch();
+            return header;
+        }
+
+        class CacheWriter
+        {
+        public:
+            template<typename T>
+            void Add(SectionId id, const std::vector<T>& data)
+            {
+                CacheSection section = {id, sizeof(T), 0, data.size()};
+                m_sections.push_back(section);
+                m_data.push_back(data.empty() ? nullptr : (const char*)data.data());
+            }
+
+            // Writes to a temporary file first so a crash never leaves a
+            // half written cache behind
+            bool Write(const QString& path, CacheHeader header)
+            {
+                header.SectionCount = m_sections.size();
+
+                qint64 offset = Align(sizeof(CacheHeader) + m_sections.size() * sizeof(CacheSection));
+                for (CacheSection& section : m_sections) {
+                    section.Offset = offset;
+                    offset = Align(offset + section.Count * section.ElementSize);
+                }
+
+                QString temp = path + ".tmp";
+                QFile file(temp);
+                if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                    return false;
+                }
+
+                bool ok = file.write((const char*)&header, sizeof(header)) == sizeof(header);
+                ok = ok && file.write((const char*)m_sections.data(), m_sections.size() * sizeof(CacheSection))
+                        == qint64(m_sections.size() * sizeof(CacheSection));
+                for (size_t i = 0; ok && i < m_sections.size(); i++) {
+                    const qint64 bytes = m_sections[i].Count * m_sections[i].ElementSize;
+                    ok = file.seek(m_sections[i].Offset)
+                      && (bytes == 0 || file.write(m_data[i], bytes) == bytes);
+                }
+                ok = ok && file.resize(offset);
+                file.close();
+
+                if (!ok) {
+                    QFile::remove(temp);
+                    return false;
+                }
+                QFile::remove(path);
+                return QFile::rename(temp, path);
+            }
+
+        private:
+            std::vector<CacheSection> m_sections;
+            std::vector<const char*> m_data;
+        };
+
+        class MappedCache
+        {
+        public:
+            ~MappedCache()
+            {
+                if (m_base) m_file.unmap(m_base);
+            }
+
+            bool Open(const QString& path, const CacheHeader& expected)
+            {
+                m_file.setFileName(path);
+                if (!m_file.open(QIODevice::ReadOnly)) return false;
+
+                m_size = m_file.size();
+                if (m_size < qint64(sizeof(CacheHeader))) return false;
+
+                m_base = m_file.map(0, m_size);
+                if (!m_base) return false;
+
+                const CacheHeader* header = (const CacheHeader*)m_base;
+                if (!std::equal(CacheMagic, CacheMagic + 4, header->Magic)
+                 || header->Version != expected.Version
+                 || header->Kind != expected.Kind
+                 || header->Param != expected.Param
+                 || header->SourceSize != expected.SourceSize
+                 || header->SourceTime != expected.SourceTime) {
+                    return false;
+                }
+
+                m_sections = (const CacheSection*)(m_base + sizeof(CacheHeader));
+                m_count = header->SectionCount;
+                return qint64(sizeof(CacheHeader) + m_count * sizeof(CacheSection)) <= m_size;
+            }
+
+            template<typename T>
+            bool Read(SectionId id, std::vector<T>& out) const
+            {
+                for (quint32 i = 0; i < m_count; i++) {
+                    const CacheSection& section = m_sections[i];
+                    if (section.Id != id) continue;
+
+                    // a corrupt or truncated file may hold anything,
+                    // Offset + Count * size could wrap around
+                    if (section.ElementSize != sizeof(T)
+                     || section.Offset > quint64(m_size)
+                     || section.Count > (quint64(m_size) - section.Offset) / sizeof(T)) {
+                        return false;
+                    }
+                    const T* first = (const T*)(m_base + section.Offset);
+                    out.assign(first, first + section.Count);
+                    return true;
+                }
+                return false;
+            }
+
+        private:
+            QFile m_file;
+            uchar* m_base = nullptr;
+            qint64 m_size = 0;
+            const CacheSection* m_sections = nullptr;
+            quint32 m_count = 0;
+        };
+    }
+
+    namespace {
+
+        bool IndicesBelow(const std::vector<int>& index, size_t count)
+        {
+            for (int i : index) {
+                if (i < 0 || size_t(i) >= count) return false;
+            }
+            return true;
+        }
+
+        // a cache that passed the bounds checks may still hold garbage,
+        // nothing in it is used as an index before it went through these
+        struct CachedHull
+        {
+            std::vector<VerNorm>  Data;
+            std::vector<int>      Index;
+            std::vector<HullFace> Faces;
+            std::vector<int>      FaceVertices;
+            std::vector<int>      AdjOffset;
+            std::vector<int>      Adjacent;
+
+            bool IsSound() const
+            {
+                const size_t vertices = Data.size();
+                if (Index.size() % 3 != 0 || !IndicesBelow(Index, vertices)) return false;
+                if (!IndicesBelow(FaceVertices, vertices)) return false;
+                for (const HullFace& face : Faces) {
+                    if (face.First < 0 || face.Count < 0
+                     || face.First > int(FaceVertices.size()) - face.Count) {
+                        return false;
+                    }
+                }
+
+                if (AdjOffset.size() != vertices + 1 || AdjOffset.front() != 0
+                 || AdjOffset.back() != int(Adjacent.size())) {
+                    return false;
+                }
+                for (size_t v = 0; v < vertices; v++) {
+                    if (AdjOffset[v] > AdjOffset[v + 1]) return false;
+                }
+                return IndicesBelow(Adjacent, vertices);
+            }
+        };
+
+        struct CachedMesh
+        {
+            std::vector<QVector3D> Vertices;
+            std::vector<int>       Index;
+            std::vector<VerNorm>   Data;
+            BVH                    Tree;
+
+            bool IsSound() const
+            {
+                return Index.size() % 3 == 0
+                    && IndicesBelow(Index, Vertices.size())
+                    && Tree.IsValid(Index.size() / 3);
+            }
+        };
+    }
+
+    QString AssetCache::CachePath(const QString& path)
+    {
+        return path + ".wfpc";
+    }
+
+    bool AssetCache::Import(const QString& path, std::vector<QVector3D>& vertices, std::vector<int>& index)
+    {
+#ifdef WFPE_ASSIMP
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path.toStdString(),
+            aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_PreTransformVertices);
+        if (!scene) {
+            qDebug() << "[AssetCache::Import]" << importer.GetErrorString();
+            return false;
+        }
+
+        vertices.clear();
+        index.clear();
+        for (unsigned m = 0; m < scene->mNumMeshes; m++) {
+            const aiMesh* mesh = scene->mMeshes[m];
+            const int base = vertices.size();
+            for (unsigned v = 0; v < mesh->mNumVertices; v++) {
+                const aiVector3D& p = mesh->mVertices[v];
+                vertices.push_back(QVector3D(p.x, p.y, p.z));
+            }
+            for (unsigned f = 0; f < mesh->mNumFaces; f++) {
+                const aiFace& face = mesh->mFaces[f];
+                if (face.mNumIndices != 3) continue; // points and lines
+                index.push_back(base + face.mIndices[0]);
+                index.push_back(base + face.mIndices[1]);
+                index.push_back(base + face.mIndices[2]);
+            }
+        }
+        return !vertices.empty();
+#else
+        Q_UNUSED(vertices);
+        Q_UNUSED(index);
+        qDebug() << "[AssetCache::Import] built without assimp, can't import" << path;
+        return false;
+#endif
+    }
+
+    bool AssetCache::LoadHull(const QString& path, impl::HullCollider& hull, int maxVertices)
+    {
+        const QString cache = CachePath(path);
+        const CacheHeader header = MakeHeader(QFileInfo(path), KindHull, maxVertices);
+
+        {
+            // read aside, the hull only changes once the whole cache checked out
+            CachedHull cached;
+            MappedCache mapped;
+            if (mapped.Open(cache, header)
+             && mapped.Read(HullVertices,     cached.Data)
+             && mapped.Read(HullIndex,        cached.Index)
+             && mapped.Read(HullFaces,        cached.Faces)
+             && mapped.Read(HullFaceVertices, cached.FaceVertices)
+             && mapped.Read(HullAdjOffset,    cached.AdjOffset)
+             && mapped.Read(HullAdjacent,     cached.Adjacent)
+             && cached.IsSound()) {
+                hull.m_data.swap(cached.Data);
+                hull.m_index.swap(cached.Index);
+                hull.m_faces.swap(cached.Faces);
+                hull.m_faceVertices.swap(cached.FaceVertices);
+                hull.m_adjOffset.swap(cached.AdjOffset);
+                hull.m_adjacent.swap(cached.Adjacent);
+                return true;
+            }
+        }
+
+        std::vector<QVector3D> vertices;
+        std::vector<int> index;
+        if (!Import(path, vertices, index) || !hull.setPoints(vertices, maxVertices)) {
+            return false;
+        }
+
+        CacheWriter writer;
+        writer.Add(HullVertices,     hull.m_data);
+        writer.Add(HullIndex,        hull.m_index);
+        writer.Add(HullFaces,        hull.m_faces);
+        writer.Add(HullFaceVertices, hull.m_faceVertices);
+        writer.Add(HullAdjOffset,    hull.m_adjOffset);
+        writer.Add(HullAdjacent,     hull.m_adjacent);
+        if (!writer.Write(cache, header)) {
+            qDebug() << "[AssetCache::LoadHull] could not write" << cache;
+        }
+        return true;
+    }
+
+    bool AssetCache::LoadMesh(const QString& path, impl::MeshCollider& mesh)
+    {
+        const QString cache = CachePath(path);
+        const CacheHeader header = MakeHeader(QFileInfo(path), KindMesh, 0);
+
+        {
+            // read aside, the mesh only changes once the whole cache checked out
+            CachedMesh cached;
+            MappedCache mapped;
+            if (mapped.Open(cache, header)
+             && mapped.Read(MeshVertices, cached.Vertices)
+             && mapped.Read(MeshIndex,    cached.Index)
+             && mapped.Read(MeshRender,   cached.Data)
+             && mapped.Read(BVHNodes,     cached.Tree.m_nodes)
+             && mapped.Read(BVHIndices,   cached.Tree.m_indices)
+             && cached.IsSound()) {
+                mesh.m_vertices.swap(cached.Vertices);
+                mesh.m_index.swap(cached.Index);
+                mesh.m_data.swap(cached.Data);
+                mesh.m_bvh.m_nodes.swap(cached.Tree.m_nodes);
+                mesh.m_bvh.m_indices.swap(cached.Tree.m_indices);
+                return true;
+            }
+        }
+
+        std::vector<QVector3D> vertices;
+        std::vector<int> index;
+        if (!Import(path, vertices, index)) {
+            return false;
+        }
+        mesh.setData(std::move(vertices), std::move(index));
+        mesh.BuildRenderData();
+
+        CacheWriter writer;
+        writer.Add(MeshVertices, mesh.m_vertices);
+        writer.Add(MeshIndex,    mesh.m_index);
+        writer.Add(MeshRender,   mesh.m_data);
+        writer.Add(BVHNodes,     mesh.m_bvh.m_nodes);
+        writer.Add(BVHIndices,   mesh.m_bvh.m_indices);
+        if (!writer.Write(cache, header)) {
+            qDebug() << "[AssetCache::LoadMesh] could not write" << cache;
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,42 @@
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <QString>
+#include "../Collision/HullCollider.h"
+#include "../Collision/MeshCollider.h"
+
+namespace physE {
+
+    /** @brief Loads collider geometry from model files (anything assimp reads)
+     *  and keeps the cooked result next to the source as "<file>.wfpc".
+     *
+     *  The first load imports the model, cooks it (hull, adjacency, face
+     *  planes, BVH, render vertices) and writes the cache. Later loads map
+     *  the cache file and copy the sections straight into the collider, no
+     *  cooking. A cache is only used when its version, cook parameters and
+     *  the source file's size and time stamp all match. Importing needs a
+     *  build with assimp (WFPE_ASSIMP), without it only caches load.
+     */
+    class AssetCache
+    {
+    public:
+        /** @brief Convex hull of all vertices in the file.
+         *  @param[in] maxVertices vertex budget handed to HullCollider::setPoints, 0 for the exact hull
+         */
+        static bool LoadHull(const QString& path, impl::HullCollider& hull, int maxVertices = 0);
+
+        /** @brief All triangles of the file as one static mesh.
+         */
+        static bool LoadMesh(const QString& path, impl::MeshCollider& mesh);
+
+        /** @brief Cache file used for path.
+         */
+        static QString CachePath(const QString& path);
+
+    private:
+        static bool Import(const QString& path, std::vector<QVector3D>& vertices, std::vector<int>& index);
+    };
+
+}
+
+#endif // ASSETCACHE_H
@@ -1,27 +1,603 @@
 #include "cloth.h"
+#include "../algo/parallel.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
 
 Cloth::Cloth()
 {
-    for (uint32_t y(0); y < cloth_height; ++y) {
-            // This is just an arbitrary formula to make the top links stronger since
-            // they are under bigger stress
-            const float max_elongation = 1.2f * (2.0f - y / float(cloth_height));
-            for (uint32_t x(0); x < cloth_width; ++x) {
+    for (int y(0); y < cloth_height; ++y) {
+            // This is just an arbitrary formula to make the links near the
+            // pinned edges stronger since they are under bigger stress
+            const float edge = std::abs(2.0f * y / float(cloth_height - 1) - 1.0f);
+            const float max_elongation = 1.2f * (1.0f + edge);
+            for (int x(0); x < cloth_width; ++x) {
                 const int id = addParticle(
-                    QVector3D(start_x + x * links_length, y * links_length, 0)
+                    origin + QVector3D(x * links_length, 0, y * links_length)
                 );
                 // Add left link if there is a particle on the left
                 if (x > 0) {
                     addLink(id-1, id, max_elongation * 0.9f);
                 }
+                if (x > 0 && y > 0) {
+                    const int top_left = id - cloth_width - 1;
+                    triangles.insert(triangles.end(), {top_left, id - cloth_width, id});
+                    triangles.insert(triangles.end(), {top_left, id, id - 1});
+                }
                 // Add top link if there is a particle on the top
                 if (y > 0) {
                     addLink(id-cloth_width, id, max_elongation);
-                } else {
-                    // If not, pin the particle
-                    objects[id]->moving = false;
                 }
+                // Pin both edges
+                if (y == 0 || y + 1 == cloth_height) {
+                    particles.pin(id);
+                }
+                // Shear links cross the cell up and to the left
+                if (x > 0 && y > 0) {
+                    addLink(id-cloth_width-1, id, max_elongation, LinkType::Shear);
+                    addLink(id-cloth_width, id-1, max_elongation, LinkType::Shear);
+                }
+                // Bending links skip one particle in each direction
+                if (x > 1) {
+                    addLink(id-2, id, max_elongation * 0.9f, LinkType::Bending);
+                }
+                if (y > 1) {
+                    addLink(id-2*cloth_width, id, max_elongation, LinkType::Bending);
+                }
+            }
+    }
+
+}
+
+// Runs of structural links through particles with exactly two links are
+// ropes. They are taken out of the link solver and become chains.
+void Cloth::detectChains(int min_links)
+{
+    // the torn list holds link indices, settle it before they move
+    tearBrokenLinks();
+
+    const int count = particles.size();
+    std::vector<int> offsets(count + 1, 0);
+    for (const LinkConstraint& l: constraints) {
+        if (!l.isValid() || l.type != LinkType::Structural) continue;
+        offsets[l.particle_1 + 1]++;
+        offsets[l.particle_2 + 1]++;
+    }
+    for (int i = 0; i < count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+    std::vector<int> incident(offsets[count]);
+    std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t k = 0; k < constraints.size(); ++k) {
+        const LinkConstraint& l = constraints[k];
+        if (!l.isValid() || l.type != LinkType::Structural) continue;
+        incident[cursor[l.particle_1]++] = k;
+        incident[cursor[l.particle_2]++] = k;
+    }
+    auto degree = [&](int p) { return offsets[p + 1] - offsets[p]; };
+
+    // walk from every end of a run, closed loops have no end and stay links
+    std::vector<bool> taken(constraints.size(), false);
+    for (int start = 0; start < count; ++start) {
+        if (degree(start) == 2) continue;
+        for (int k = offsets[start]; k < offsets[start + 1]; ++k) {
+            if (taken[incident[k]]) continue;
+
+            std::vector<int> ids(1, start);
+            std::vector<int> links;
+            int link = incident[k];
+            int p = start;
+            for (;;) {
+                const LinkConstraint& l = constraints[link];
+                p = l.particle_1 == p ? l.particle_2 : l.particle_1;
+                ids.push_back(p);
+                links.push_back(link);
+                if (degree(p) != 2) break;
+                link = incident[offsets[p]] == link ? incident[offsets[p] + 1] : incident[offsets[p]];
+            }
+            if (int(links.size()) < min_links) continue;
+
+            for (int l: links) {
+                taken[l] = true;
+            }
+            addChain(std::move(ids));
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t k = 0; k < constraints.size(); ++k) {
+        if (!taken[k]) constraints[kept++] = constraints[k];
+    }
+    if (kept != constraints.size()) {
+        constraints.resize(kept);
+        topologyChanged();
+    }
+}
+
+// Gathers for every particle the ones it may touch during this update,
+// skipping everything it is linked to. The search reaches as far as the
+// particles can move towards each other, up to one more thickness.
+void Cloth::findSelfCollisions(float dt)
+{
+    if (adjacency_dirty || particle_links.size() != particles.size()) buildAdjacency();
+
+    const int n = particles.size();
+    const QVector3D* x = particles.position.data();
+    float max_speed = 0.0f;
+    for (const QVector3D& v: particles.velocity) {
+        max_speed = std::max(max_speed, v.lengthSquared());
+    }
+    max_speed = std::sqrt(max_speed);
+    const float radius = self_thickness + std::min(2.0f * max_speed * dt, self_thickness);
+
+    self_hash.Build(x, n, radius);
+    self_counts.assign(n, 0);
+    self_partners.resize(n * max_self_partners);
+
+    physE::ParallelFor(n, 1024, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            int* partners = &self_partners[i * max_self_partners];
+            int& count = self_counts[i];
+            const std::vector<int>& links = particle_links[i];
+            self_hash.Query(x[i], radius, [&](int j) {
+                if (j <= i || count == max_self_partners) return;
+                if (!particles.moving(i) && !particles.moving(j)) return;
+                for (int l: links) {
+                    const LinkConstraint& c = constraints[l];
+                    if (c.particle_1 == j || c.particle_2 == j) return;
+                }
+                // hashed cells can share an entry, so j may come twice
+                if (std::find(partners, partners + count, j) != partners + count) return;
+                partners[count++] = j;
+            });
+        }
+    });
+}
+
+void Cloth::solveSelfCollisions()
+{
+    QVector3D*   x = particles.position.data();
+    const float* w = particles.inv_mass.data();
+    for (int i = 0, n = self_counts.size(); i < n; ++i) {
+        const int* partners = &self_partners[i * max_self_partners];
+        for (int k = 0; k < self_counts[i]; ++k) {
+            const int j = partners[k];
+            const QVector3D d = x[i] - x[j];
+            const float dist = d.length();
+            if (dist >= self_thickness || dist == 0.0f) continue;
+
+            const QVector3D p = d * ((self_thickness - dist) / (dist * (w[i] + w[j])));
+            x[i] += p * w[i];
+            x[j] -= p * w[j];
+        }
+    }
+}
+
+// Pushes every particle back in front of its contact planes. A body the
+// cloth can move takes its part of the push by moving its plane back, in
+// proportion to the inverse masses. Friction takes back the sliding along
+// the surface this substep of length h, up to friction times the push.
+void Cloth::solveContacts(float h)
+{
+    QVector3D*       x = particles.position.data();
+    const QVector3D* x_old = particles.position_old.data();
+    const float*     w = particles.inv_mass.data();
+    for (ClothContact& c: contacts) {
+        const int i = c.particle;
+        if (w[i] == 0.0f) continue;
+        const QVector3D point = c.point + c.offset;
+        const float depth = collision_radius - QVector3D::dotProduct(x[i] - point, c.normal);
+        if (depth <= 0.0f) continue;
+
+        const float share = w[i] / (w[i] + c.inv_mass);
+        c.offset -= depth * (1.0f - share) * c.normal;
+        QVector3D dx = depth * share * c.normal;
+        const QVector3D slide = x[i] - x_old[i] - c.velocity * h;
+        const QVector3D tangent = slide - QVector3D::dotProduct(slide, c.normal) * c.normal;
+        const float length = tangent.length();
+        if (length > 0.0f) {
+            dx -= tangent * std::min(1.0f, collision_friction * depth / length);
+        }
+        x[i] += dx;
+        c.impulse += dx / (w[i] * h);
+    }
+}
+
+// Each link that broke since the last update tears the cloth at one end.
+// Only the links in the torn list are looked at, dead links are compacted
+// away once there are enough of them.
+void Cloth::tearBrokenLinks()
+{
+    if (torn.empty()) return;
+
+    std::vector<int> links;
+    torn.take(links);
+    if (adjacency_dirty || particle_links.size() != particles.size()) buildAdjacency();
+    for (int link: links) {
+        splitParticle(link);
+    }
+    dead_links += links.size();
+
+    // splitting keeps the coloring valid, every copy only has a subset of
+    // the links of its original
+    attachments_dirty = true;
+    projective_dirty = true;
+    if (dead_links * 8 > int(constraints.size())) compactLinks();
+}
+
+// Splits the moving end of a broken link in two. The links and triangles
+// of that particle lying towards the other end move to the copy, so the
+// gap opens in the mesh as well.
+void Cloth::splitParticle(int link)
+{
+    int p = constraints[link].particle_1;
+    int q = constraints[link].particle_2;
+    if (!particles.moving(p) || (particles.moving(q) && particle_links[q].size() > particle_links[p].size())) {
+        std::swap(p, q);
+    }
+    if (!particles.moving(p)) return;
+
+    const QVector3D origin = particles.position[p];
+    const QVector3D normal = particles.position[q] - origin;
+    auto beyond = [&](const QVector3D& point) {
+        return QVector3D::dotProduct(point - origin, normal) > 0.0f;
+    };
+
+    std::vector<int> moved_links;
+    size_t intact = 0;
+    for (int l: particle_links[p]) {
+        const LinkConstraint& c = constraints[l];
+        if (!c.isValid()) continue;
+        ++intact;
+        if (beyond(particles.position[c.particle_1 == p ? c.particle_2 : c.particle_1])) {
+            moved_links.push_back(l);
+        }
+    }
+    // the tear ends here if one side has nothing left
+    if (moved_links.empty() || moved_links.size() == intact) return;
+
+    std::vector<int> moved_triangles;
+    for (int t: particle_triangles[p]) {
+        const int* v = &triangles[3 * t];
+        const QVector3D center = (particles.position[v[0]] + particles.position[v[1]] + particles.position[v[2]]) / 3.0f;
+        if (beyond(center)) moved_triangles.push_back(t);
+    }
+
+    const int copy = particles.add(origin);
+    particles.position_old[copy] = particles.position_old[p];
+    particles.velocity[copy]     = particles.velocity[p];
+    particles.inv_mass[copy]     = particles.inv_mass[p];
+    particle_links.emplace_back();
+    particle_triangles.emplace_back();
+
+    std::vector<int>& links_p = particle_links[p];
+    for (int l: moved_links) {
+        LinkConstraint& c = constraints[l];
+        (c.particle_1 == p ? c.particle_1 : c.particle_2) = copy;
+        links_p.erase(std::find(links_p.begin(), links_p.end(), l));
+        particle_links[copy].push_back(l);
+    }
+    std::vector<int>& triangles_p = particle_triangles[p];
+    for (int t: moved_triangles) {
+        *std::find(&triangles[3 * t], &triangles[3 * t + 3], p) = copy;
+        triangles_p.erase(std::find(triangles_p.begin(), triangles_p.end(), t));
+        particle_triangles[copy].push_back(t);
+        dirty_triangles.push_back(t);
+    }
+}
+
+void Cloth::buildAdjacency()
+{
+    particle_links.assign(particles.size(), std::vector<int>());
+    particle_triangles.assign(particles.size(), std::vector<int>());
+    for (size_t k = 0; k < constraints.size(); ++k) {
+        const LinkConstraint& l = constraints[k];
+        if (!l.isValid()) continue;
+        particle_links[l.particle_1].push_back(k);
+        particle_links[l.particle_2].push_back(k);
+    }
+    for (size_t t = 0; t < triangles.size() / 3; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            particle_triangles[triangles[3 * t + k]].push_back(t);
+        }
+    }
+    adjacency_dirty = false;
+}
+
+// Drops the dead links. Each color is compacted in place, so the coloring
+// survives unless it is going to be redone anyway.
+void Cloth::compactLinks()
+{
+    auto dead = [](const LinkConstraint& c) { return !c.isValid(); };
+    if (colors_dirty || color_offsets.empty()) {
+        constraints.erase(std::remove_if(constraints.begin(), constraints.end(), dead), constraints.end());
+    }
+    else {
+        int kept = 0;
+        const int colors = int(color_offsets.size()) - 1;
+        for (int c = 0; c < colors; ++c) {
+            const int begin = color_offsets[c];
+            const int end   = color_offsets[c + 1];
+            color_offsets[c] = kept;
+            for (int i = begin; i < end; ++i) {
+                if (!dead(constraints[i])) constraints[kept++] = constraints[i];
+            }
+        }
+        color_offsets[colors] = kept;
+        constraints.resize(kept);
+    }
+    dead_links = 0;
+    adjacency_dirty = true;
+    projective_dirty = true;
+}
+
+void Cloth::computeAttachments()
+{
+    // Dijkstra from all pinned particles at once over the intact links and
+    // ropes, weighted by rest length, so every particle finds its nearest pin
+    struct Edge { int a, b; float length; };
+    std::vector<Edge> edges;
+    for (const LinkConstraint& l: constraints) {
+        if (l.isValid()) edges.push_back({l.particle_1, l.particle_2, l.distance});
+    }
+    for (const ChainConstraint& chain: chains) {
+        for (size_t i = 0; i < chain.segments(); ++i) {
+            edges.push_back({chain.particles[i], chain.particles[i + 1], chain.rest[i]});
+        }
+    }
+
+    const int count = particles.size();
+    std::vector<int> offsets(count + 1, 0);
+    for (const Edge& e: edges) {
+        offsets[e.a + 1]++;
+        offsets[e.b + 1]++;
+    }
+    for (int i = 0; i < count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+    std::vector<int>   neighbours(offsets[count]);
+    std::vector<float> lengths(offsets[count]);
+    std::vector<int>   cursor(offsets.begin(), offsets.end() - 1);
+    for (const Edge& e: edges) {
+        neighbours[cursor[e.a]] = e.b;
+        lengths[cursor[e.a]++] = e.length;
+        neighbours[cursor[e.b]] = e.a;
+        lengths[cursor[e.b]++] = e.length;
+    }
+
+    typedef std::pair<float, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    std::vector<float> geodesic(count, FLT_MAX);
+    std::vector<int>   anchor(count, -1);
+    for (int i = 0; i < count; ++i) {
+        if (particles.moving(i)) continue;
+        geodesic[i] = 0.0f;
+        anchor[i] = i;
+        open.push(Entry(0.0f, i));
+    }
+    while (!open.empty()) {
+        const Entry e = open.top();
+        open.pop();
+        if (e.first > geodesic[e.second]) continue;
+        for (int k = offsets[e.second]; k < offsets[e.second + 1]; ++k) {
+            const int   n = neighbours[k];
+            const float d = e.first + lengths[k];
+            if (d < geodesic[n]) {
+                geodesic[n] = d;
+                anchor[n] = anchor[e.second];
+                open.push(Entry(d, n));
+            }
+        }
+    }
+
+    // particles torn off from every pin are left alone
+    attachments.clear();
+    for (int i = 0; i < count; ++i) {
+        if (particles.moving(i) && anchor[i] >= 0) {
+            attachments.push_back({i, anchor[i], geodesic[i]});
+        }
+    }
+    attachments_dirty = false;
+}
+
+void Cloth::solveAttachments()
+{
+    // every attachment moves a different particle, and anchors never move
+    QVector3D* x = particles.position.data();
+    physE::ParallelFor(attachments.size(), 4096, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const Attachment& a = attachments[i];
+            const QVector3D d = x[a.particle] - x[a.anchor];
+            const float dist = d.length();
+            if (dist > a.max_distance) {
+                x[a.particle] = x[a.anchor] + d * (a.max_distance / dist);
+            }
+        }
+    });
+}
+
+void Cloth::colorConstraints()
+{
+    // Greedy coloring, every link takes the lowest color neither of its
+    // particles has yet. A grid cloth ends up with 4 colors.
+    const int max_colors = 64;
+    std::vector<uint64_t> used(particles.size(), 0);
+    std::vector<int>      color(constraints.size());
+    std::vector<int>      count(max_colors + 1, 0);
+    int color_count = 0;
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        const LinkConstraint& l = constraints[i];
+        const uint64_t taken = used[l.particle_1] | used[l.particle_2];
+        int c = 0;
+        while (c < max_colors - 1 && (taken >> c & 1)) ++c;
+
+        color[i] = c;
+        used[l.particle_1] |= uint64_t(1) << c;
+        used[l.particle_2] |= uint64_t(1) << c;
+        count[c + 1]++;
+        color_count = std::max(color_count, c + 1);
+    }
+    serial_last_color = color_count == max_colors;
+
+    color_offsets.assign(color_count + 1, 0);
+    for (int c = 0; c < color_count; ++c) {
+        color_offsets[c + 1] = color_offsets[c] + count[c + 1];
+    }
+
+    std::vector<LinkConstraint> sorted(constraints.size());
+    std::vector<int> cursor(color_offsets.begin(), color_offsets.end() - 1);
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        sorted[cursor[color[i]]++] = constraints[i];
+    }
+    constraints.swap(sorted);
+    colors_dirty = false;
+    // both refer to links by index
+    projective_dirty = true;
+    adjacency_dirty = true;
+}
+
+void Cloth::solveColor(int color, float inv_dt2)
+{
+    const bool xpbd = solver == ClothSolver::XPBD;
+    const int begin = color_offsets[color];
+    const int end   = color_offsets[color + 1];
+
+    if (serial_last_color && color + 2 == int(color_offsets.size())) {
+        for (int i = begin; i < end; ++i) {
+            const bool valid = constraints[i].isValid();
+            constraints[i].solve(particles, xpbd, inv_dt2);
+            if (valid && constraints[i].broken) torn.add(i);
+        }
+        return;
+    }
+
+    physE::ParallelFor(end - begin, 2048, [&](int b, int e) {
+        solveLinks(begin + b, begin + e, inv_dt2);
+    });
+}
+
+// Links of one color in blocks: gather the block into flat arrays, run the
+// math as a straight loop, scatter the corrections back. Same update as
+// LinkConstraint::solve. The middle loop has no branches, conditions are
+// 0/1 masks that are multiplied in, so it vectorizes; with GCC that needs
+// -ftree-vectorize and -fno-math-errno for the sqrt, see WFPE.pro.
+void Cloth::solveLinks(int begin, int end, float inv_dt2)
+{
+    const int block = 64;
+    float dx[block];
+    float dy[block];
+    float dz[block];
+    float w_1[block];
+    float w_2[block];
+    float rest[block];
+    float strength[block];
+    float alpha[block];
+    float lambda[block];
+    float one_sided[block];
+    float ratio[block];
+    float scale[block];
+    float broke[block];
+
+    const bool   xpbd = solver == ClothSolver::XPBD;
+    QVector3D*   x = particles.position.data();
+    const float* w = particles.inv_mass.data();
+
+    for (int base = begin; base < end; base += block) {
+        const int n = std::min(block, end - base);
+        LinkConstraint* links = constraints.data() + base;
+
+        for (int i = 0; i < n; ++i) {
+            const LinkConstraint& l = links[i];
+            const QVector3D d = x[l.particle_1] - x[l.particle_2];
+            dx[i] = d.x();
+            dy[i] = d.y();
+            dz[i] = d.z();
+            // broken links, and in PBD the links it doesn't solve, get no
+            // weight and so no correction
+            const bool skip = l.broken || (!xpbd && l.type != LinkType::Structural);
+            w_1[i] = skip ? 0.0f : w[l.particle_1];
+            w_2[i] = skip ? 0.0f : w[l.particle_2];
+            rest[i] = l.distance;
+            strength[i] = xpbd ? 1.0f : l.strength;
+            alpha[i] = xpbd ? l.compliance * inv_dt2 : 0.0f;
+            lambda[i] = l.lambda;
+            // structural links only pull, their lambda never goes above 0
+            one_sided[i] = l.type == LinkType::Structural ? 1.0f : 0.0f;
+            ratio[i] = l.max_elongation_ratio;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const float dist = std::sqrt(dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i]);
+            const float w_sum = w_1[i] + w_2[i];
+            // both positive, written as one compare and select since a
+            // bool to float conversion or && leaves a branch behind
+            const float active = std::min(dist, w_sum) > 0.0f ? 1.0f : 0.0f;
+            // an inactive link may have nothing to divide by, its result
+            // is masked out anyway
+            const float unclamped = (-strength[i] * (dist - rest[i]) - alpha[i] * lambda[i])
+                             / (w_sum + alpha[i] + (1.0f - active));
+            const float clamped = std::min(unclamped, -lambda[i]);
+            const float d_lambda = active * (one_sided[i] * clamped + (1.0f - one_sided[i]) * unclamped);
+            lambda[i] += d_lambda;
+            scale[i] = d_lambda / std::max(dist, FLT_MIN);
+            broke[i] = dist > rest[i] * ratio[i] ? active : 0.0f;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const QVector3D c = QVector3D(dx[i], dy[i], dz[i]) * scale[i];
+            x[links[i].particle_1] += c * w_1[i];
+            x[links[i].particle_2] -= c * w_2[i];
+            if (xpbd) links[i].lambda = lambda[i];
+            if (broke[i] != 0.0f) {
+                links[i].broken = true;
+                torn.add(base + i);
             }
+        }
+    }
+}
+
+// Positions stream into a freshly orphaned buffer every frame, so the
+// driver hands out new storage instead of stalling until the GPU is done
+// with the last frame. The indices are uploaded once, a tear only patches
+// the triangles it moved.
+void Cloth::Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram)
+{
+    if (triangles.empty()) return;
+    const int bytes = particles.size() * sizeof(QVector3D);
+
+    if (vao.objectId() == 0) {
+        vao.create();
+        vao.bind();
+        vbo.create();
+        vbo.setUsagePattern(QOpenGLBuffer::StreamDraw);
+        vbo.bind();
+        vbo.allocate(bytes);
+        ebo.create();
+        ebo.bind();
+        ebo.allocate(triangles.data(), triangles.size() * sizeof(int));
+
+        shaderProgram->enableAttributeArray(0);
+        shaderProgram->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(QVector3D));
+        vao.release();
+        dirty_triangles.clear();
+    }
+
+    QOpenGLVertexArrayObject::Binder bind(&vao);
+    vbo.bind();
+    vbo.allocate(bytes);
+    vbo.write(0, particles.position.data(), bytes);
+
+    if (!dirty_triangles.empty()) {
+        ebo.bind();
+        for (int t: dirty_triangles) {
+            ebo.write(3 * t * sizeof(int), &triangles[3 * t], 3 * sizeof(int));
+        }
+        dirty_triangles.clear();
     }
 
+    shaderProgram->setUniformValue("model", QMatrix4x4());
+    glFunc->glDrawElements(GL_TRIANGLES, triangles.size(), GL_UNSIGNED_INT, 0);
 }
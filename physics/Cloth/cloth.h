@@ -10,96 +10,319 @@
 #include <QOpenGLWidget>
 #include <QtOpenGLExtensions/QOpenGLExtensions>
 #include "../Constraints/linkconstraints.h"
+#include "../Constraints/chainconstraint.h"
+#include "projectivedynamics.h"
+#include "../algo/spatialhash.h"
+
+// PBD runs 32 iterations of the structural links over the whole step.
+// XPBD splits every update into substeps with few iterations each, the
+// compliances set how stiff each kind of link is. Projective Dynamics takes
+// the whole step at once with a prefactored global solve per iteration.
+enum class ClothSolver
+{
+    PBD,
+    XPBD,
+    Projective,
+};
+
+// Long range attachment: particle may not get further from the pinned
+// anchor than the geodesic distance between them along the links
+struct Attachment
+{
+    int   particle;
+    int   anchor;
+    float max_distance;
+};
+
+// Contact with a collider of the world, found once per world step by
+// physicalworld::CollideCloth: the particle stays collision_radius in front
+// of the plane through point + offset. velocity is the body's surface, for
+// friction. inv_mass is the body's share of a push, offset how far it has
+// backed off and impulse the momentum the particle got, the world hands
+// both on to the body.
+struct ClothContact
+{
+    int       particle;
+    QVector3D point;
+    QVector3D normal;
+    QVector3D velocity;
+    QVector3D impulse;
+    QVector3D offset;
+    float     inv_mass;
+};
 
 class Cloth
 {
 public:
-    // Initialize the cloth
-    int cloth_width  = 60;
+    // A hammock in world units: cloth_width particles along x by
+    // cloth_height along z, starting at origin, pinned along both x edges
+    // so falling bodies land in it
+    int cloth_width  = 50;
     int cloth_height = 30;
-    float    links_length = 20.0f;
-    float    start_x      = ((cloth_width - 1) * links_length) * 0.5f;
-    std::vector<Particle*>       objects;
+    float     links_length  = 0.8f;
+    float     particle_mass = 1.0f;
+    QVector3D origin       = QVector3D(-0.5f * (cloth_width - 1) * links_length, 10.0f,
+                                       -0.5f * (cloth_height - 1) * links_length);
+    ParticleStore               particles;
+    // Links are grouped by color, no two links of a color share a
+    // particle, so a color can be solved in parallel. Color c is
+    // [color_offsets[c], color_offsets[c + 1]); the last color may hold
+    // leftovers of particles with more than 63 links and is solved serially.
     std::vector<LinkConstraint> constraints;
+    std::vector<int>            color_offsets;
+    bool                        serial_last_color = false;
+    bool                        colors_dirty      = true;
+    // Broken links stay in place, the solvers skip them, until a fair
+    // share of a color is dead and the colors are compacted
+    BrokenLinks                 torn;
+    int                         dead_links        = 0;
+    // Render mesh, two triangles per cell. Tearing splits particles and
+    // moves triangles over to the new ones, their indices are collected in
+    // dirty_triangles for the renderer to patch.
+    std::vector<int>            triangles;
+    std::vector<int>            dirty_triangles;
+    // Links and triangles at every particle, built on the first tear
+    std::vector<std::vector<int>> particle_links;
+    std::vector<std::vector<int>> particle_triangles;
+    bool                        adjacency_dirty   = true;
+    // Inextensible ropes, solved directly after the links every iteration
+    std::vector<ChainConstraint> chains;
+    // Each moving particle is tied to its nearest pinned particle
+    std::vector<Attachment>     attachments;
+    bool                        attachments_dirty = true;
+    // Refactored only when the links change
+    ProjectiveSolver            projective;
+    bool                        projective_dirty  = true;
+
+    // Self collision pushes apart particles closer than self_thickness that
+    // are not linked. Candidates come from a spatial hash built once per
+    // update, the pairs are projected every self_collision_interval-th
+    // iteration.
+    bool                        self_collision          = false;
+    float                       self_thickness          = 0.5f * links_length;
+    int                         self_collision_interval = 2;
+    physE::SpatialHash          self_hash;
+    std::vector<int>            self_partners;  // max_self_partners per particle
+    std::vector<int>            self_counts;
+    int                         self_iteration          = 0;
+    static const int            max_self_partners       = 16;
+
+    // Against the colliders of the world every moving particle is a sphere
+    // of collision_radius, sliding on them with Coulomb friction. The
+    // contacts are projected with the links, every iteration, so the links
+    // never undo them
+    float                       collision_radius        = 0.25f * links_length;
+    float                       collision_friction      = 0.3f;
+    std::vector<ClothContact>   contacts;
+
+    ClothSolver solver                = ClothSolver::XPBD;
+    int         substeps              = 8;   // XPBD
+    int         iterations            = 1;   // XPBD, per substep
+    int         projective_iterations = 5;
+    float       stretch_compliance    = 0.0f;
+    float       shear_compliance      = 1e-6f;
+    float       bending_compliance    = 1e-4f;
+    float       air_friction          = 0.5f;  // drag per unit of velocity
+
+    // The cloth runs on its own fixed step whatever the frame time is, so
+    // the projective factorization stays valid and the result doesn't
+    // depend on the frame rate. Leftover time carries over to the next
+    // update; after a long stall at most max_steps are taken and the rest
+    // is dropped.
+    float       fixed_dt              = 1.0f / 60.0f;
+    int         max_steps             = 4;
+    float       time_accumulator      = 0.0f;
 
     Cloth();
 
-    void update(float dt)
+    // gravity is the world's, so the cloth falls the same way as the bodies
+    void update(float dt, const QVector3D& gravity)
     {
-        removeBrokenLinks();
-        applyGravity();
-        applyAirFriction();
-        updatePositions(dt);
-        solveConstraints();
-        updateDerivatives(dt);
+        time_accumulator += dt;
+        int steps = 0;
+        while (time_accumulator >= fixed_dt && steps < max_steps) {
+            step(fixed_dt, gravity);
+            time_accumulator -= fixed_dt;
+            ++steps;
+        }
+        if (time_accumulator >= fixed_dt) {
+            time_accumulator = 0.0f;
+        }
     }
 
-    void applyGravity()
+    void step(float dt, const QVector3D& gravity)
     {
-        const QVector3D gravity(0.0f, 1500.0f, 0.0f);
-        for (Particle* p : objects) {
-            p->forces += gravity * p->mass;
+        tearBrokenLinks();
+        if (self_collision) findSelfCollisions(dt);
+        if (solver == ClothSolver::PBD) {
+            updatePositions(dt, gravity);
+            solveConstraints(32, dt, 0.0f);
+            updateDerivatives(dt);
+            return;
+        }
+        if (solver == ClothSolver::Projective) {
+            updatePositions(dt, gravity);
+            solveProjective(dt);
+            updateDerivatives(dt);
+            return;
         }
-    }
 
-    void applyAirFriction()
-    {
-        const float friction_coef = 0.5f;
-        for (Particle* p : objects) {
-            p->forces -= p->velocity * friction_coef;
+        const float h = dt / substeps;
+        for (int s = 0; s < substeps; ++s) {
+            updatePositions(h, gravity);
+            for (LinkConstraint &l: constraints) {
+                l.lambda = 0.0f;
+            }
+            solveConstraints(iterations, h, 1.0f / (h * h));
+            updateDerivatives(h);
         }
     }
 
-    void updatePositions(float dt)
+    // Gravity and air friction are the only forces, so they are applied
+    // as accelerations right in the integration pass
+    void updatePositions(float dt, const QVector3D& gravity)
     {
-        for (Particle* p : objects) {
-            p->update(dt);
+        QVector3D*   x = particles.position.data();
+        QVector3D*   x_old = particles.position_old.data();
+        QVector3D*   v = particles.velocity.data();
+        const float* w = particles.inv_mass.data();
+        for (size_t i = 0, n = particles.size(); i < n; ++i) {
+            x_old[i] = x[i];
+            if (w[i] == 0.0f) continue;
+            v[i] += (gravity - v[i] * (air_friction * w[i])) * dt;
+            x[i] += v[i] * dt;
         }
     }
 
     void updateDerivatives(float dt)
     {
-        for (Particle* p : objects) {
-            p->updateDerivatives(dt);
+        const float inv_dt = 1.0f / dt;
+
+        const QVector3D* x = particles.position.data();
+        const QVector3D* x_old = particles.position_old.data();
+        QVector3D*       v = particles.velocity.data();
+        for (size_t i = 0, n = particles.size(); i < n; ++i) {
+            v[i] = (x[i] - x_old[i]) * inv_dt;
         }
     }
 
-    void solveConstraints()
+    // Gauss-Seidel over the colors in order, each color is one parallel
+    // Jacobi-free sweep since its links are independent
+    // The attachments go first every iteration, they pull the cloth back
+    // to its rest length from the pins in one go where the links would need
+    // as many iterations as there are rows. Contacts with the world go
+    // last so they have the final say.
+    void solveConstraints(int iterations, float h, float inv_dt2)
     {
-        for (uint32_t i(32); i--;) {
-            for (LinkConstraint &l: constraints) {
-                l.solve();
+        if (colors_dirty) colorConstraints();
+        if (attachments_dirty) computeAttachments();
+
+        const int colors = int(color_offsets.size()) - 1;
+        for (int i(iterations); i--;) {
+            solveAttachments();
+            for (int c = 0; c < colors; ++c) {
+                solveColor(c, inv_dt2);
+            }
+            for (ChainConstraint &chain: chains) {
+                chain.project(particles);
             }
+            if (self_collision && ++self_iteration % self_collision_interval == 0) {
+                solveSelfCollisions();
+            }
+            solveContacts(h);
+        }
+    }
+
+    // Rope of segments + 1 particles from start to end, the first one pinned
+    int addRope(QVector3D start, QVector3D end, int segments, float mass = 1.0f)
+    {
+        std::vector<int> ids;
+        for (int i = 0; i <= segments; ++i) {
+            ids.push_back(particles.add(start + (end - start) * (i / float(segments)), mass));
+        }
+        particles.pin(ids.front());
+        return addChain(std::move(ids));
+    }
+
+    int addChain(std::vector<int> ids)
+    {
+        chains.emplace_back(particles, std::move(ids));
+        topologyChanged();
+        return chains.size() - 1;
+    }
+
+    // Links are solved by the global system alone, ropes are projected
+    // afterwards since they are not part of it. Contacts go in between the
+    // iterations so the local steps see them, and once more at the end.
+    // dt is always fixed_dt, so only a change of the links refactors.
+    void solveProjective(float dt)
+    {
+        if (projective_dirty || !projective.factored(dt)) {
+            projective.factor(particles, constraints, dt);
+            projective_dirty = false;
         }
+        projective.begin(particles);
+        for (int i(projective_iterations); i--;) {
+            projective.iterate(particles, constraints, torn);
+            solveContacts(dt);
+        }
+        for (ChainConstraint &chain: chains) {
+            chain.project(particles);
+        }
+        if (self_collision) solveSelfCollisions();
+        solveContacts(dt);
     }
 
-    void removeBrokenLinks()
+    // Call after adding or removing links or ropes, or pinning particles
+    void topologyChanged()
     {
-        //constraints.remove_if([](const LinkConstraint& c) {return !c.isValid();});
-        constraints.erase(std::remove_if(constraints.begin(), constraints.end(), [](const LinkConstraint& c) {
-            return !c.isValid();
-        }), constraints.end());
+        colors_dirty = true;
+        attachments_dirty = true;
+        projective_dirty = true;
+        adjacency_dirty = true;
     }
 
+    void detectChains(int min_links = 8);
+    void computeAttachments();
+    void solveAttachments();
+    void colorConstraints();
+    void solveColor(int color, float inv_dt2);
+    void solveLinks(int begin, int end, float inv_dt2);
+
+    void findSelfCollisions(float dt);
+    void solveSelfCollisions();
+    void solveContacts(float h);
+    void tearBrokenLinks();
+    void splitParticle(int link);
+    void buildAdjacency();
+    void compactLinks();
+
     int addParticle(QVector3D position)
     {
-        const int particle_id = objects.size();
-        objects.emplace_back(new Particle(position));
-        objects[particle_id]->id = particle_id;
-        return particle_id;
+        return particles.add(position, particle_mass);
     }
 
-    void addLink(int particle_1, int particle_2, float max_elongation_ratio = 1.5f)
+    void addLink(int particle_1, int particle_2, float max_elongation_ratio = 1.5f,
+                 LinkType type = LinkType::Structural)
     {
         const int link_id = constraints.size();
-        constraints.emplace_back(LinkConstraint(objects[particle_1], objects[particle_2]));
+        constraints.emplace_back(LinkConstraint(particles, particle_1, particle_2));
+        topologyChanged();
         constraints[link_id].id = link_id;
         constraints[link_id].max_elongation_ratio = max_elongation_ratio;
+        constraints[link_id].type = type;
+        constraints[link_id].compliance = type == LinkType::Shear   ? shear_compliance
+                                        : type == LinkType::Bending ? bending_compliance
+                                                                    : stretch_compliance;
     }
 
-    void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram) {
+    // Expects the cloth program, which makes the normals on the GPU
+    void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram);
 
-    }
+private:
+    QOpenGLVertexArrayObject vao;
+    QOpenGLBuffer            vbo = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    QOpenGLBuffer            ebo = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
 };
 
 #endif // CLOTH_H
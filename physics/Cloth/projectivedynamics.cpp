@@ -0,0 +1,137 @@
+#include "projectivedynamics.h"
+#include "../algo/parallel.h"
+
+#include <cmath>
+
+void ProjectiveSolver::factor(const ParticleStore& particles, const std::vector<LinkConstraint>& links, float dt)
+{
+    const int count = particles.size();
+    std::vector<int> row(count, -1);
+    m_rows.clear();
+    for (int i = 0; i < count; ++i) {
+        if (particles.moving(i)) {
+            row[i] = m_rows.size();
+            m_rows.push_back(i);
+        }
+    }
+    const int n = m_rows.size();
+
+    // links at every row, so the right hand side can be gathered per row
+    m_offsets.assign(n + 1, 0);
+    for (const LinkConstraint& l: links) {
+        if (!l.isValid()) continue;
+        if (row[l.particle_1] >= 0) m_offsets[row[l.particle_1] + 1]++;
+        if (row[l.particle_2] >= 0) m_offsets[row[l.particle_2] + 1]++;
+    }
+    for (int i = 0; i < n; ++i) {
+        m_offsets[i + 1] += m_offsets[i];
+    }
+    m_incident.resize(m_offsets[n]);
+    std::vector<int> cursor(m_offsets.begin(), m_offsets.end() - 1);
+
+    const double inv_h2 = 1.0 / (double(dt) * dt);
+    std::vector<Eigen::Triplet<double>> entries;
+    entries.reserve(n + 4 * links.size());
+    for (int i = 0; i < n; ++i) {
+        entries.emplace_back(i, i, inv_h2 / particles.inv_mass[m_rows[i]]);
+    }
+
+    m_stiffness.assign(links.size(), 0.0f);
+    for (size_t k = 0; k < links.size(); ++k) {
+        const LinkConstraint& l = links[k];
+        if (!l.isValid()) continue;
+        const float s = stiffness(l);
+        m_stiffness[k] = s;
+
+        const int a = row[l.particle_1];
+        const int b = row[l.particle_2];
+        if (a >= 0) {
+            entries.emplace_back(a, a, s);
+            m_incident[cursor[a]++] = 2 * k;
+        }
+        if (b >= 0) {
+            entries.emplace_back(b, b, s);
+            m_incident[cursor[b]++] = 2 * k + 1;
+        }
+        if (a >= 0 && b >= 0) {
+            entries.emplace_back(a, b, -s);
+            entries.emplace_back(b, a, -s);
+        }
+    }
+
+    Eigen::SparseMatrix<double> system(n, n);
+    system.setFromTriplets(entries.begin(), entries.end());
+    m_ldlt.compute(system);
+
+    m_rhs.resize(n, 3);
+    m_x.resize(n, 3);
+    m_projections.resize(links.size());
+    m_inertial.resize(n);
+    m_dt = dt;
+    m_valid = m_ldlt.info() == Eigen::Success;
+}
+
+void ProjectiveSolver::begin(const ParticleStore& particles)
+{
+    if (!m_valid) return;
+
+    const QVector3D* x = particles.position.data();
+    for (int i = 0, n = m_rows.size(); i < n; ++i) {
+        m_inertial[i] = x[m_rows[i]];
+    }
+}
+
+void ProjectiveSolver::iterate(ParticleStore& particles, std::vector<LinkConstraint>& links, BrokenLinks& torn)
+{
+    if (!m_valid) return;
+
+    QVector3D*   x = particles.position.data();
+    const float* w = particles.inv_mass.data();
+    const int    n = m_rows.size();
+    const float  inv_h2 = 1.0f / (m_dt * m_dt);
+
+    // local step: the nearest configuration of every link
+    physE::ParallelFor(links.size(), 2048, [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            LinkConstraint& l = links[k];
+            const QVector3D d = x[l.particle_1] - x[l.particle_2];
+            const float dist = d.length();
+            // structural links only pull, a slack one stays as it is
+            const bool slack = l.type == LinkType::Structural && dist < l.distance;
+            m_projections[k] = slack || dist == 0.0f ? d : d * (l.distance / dist);
+            if (l.isValid() && dist > l.distance * l.max_elongation_ratio) {
+                l.broken = true;
+                torn.add(k);
+            }
+        }
+    });
+
+    // right hand side, gathered per row, pinned ends go in as constants
+    physE::ParallelFor(n, 1024, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            QVector3D r = m_inertial[i] * (inv_h2 / w[m_rows[i]]);
+            for (int e = m_offsets[i]; e < m_offsets[i + 1]; ++e) {
+                const int k = m_incident[e] >> 1;
+                const LinkConstraint& l = links[k];
+                const float s = m_stiffness[k];
+                if (m_incident[e] & 1) {
+                    r -= s * m_projections[k];
+                    if (!particles.moving(l.particle_1)) r += s * x[l.particle_1];
+                }
+                else {
+                    r += s * m_projections[k];
+                    if (!particles.moving(l.particle_2)) r += s * x[l.particle_2];
+                }
+            }
+            m_rhs(i, 0) = r.x();
+            m_rhs(i, 1) = r.y();
+            m_rhs(i, 2) = r.z();
+        }
+    });
+
+    // global step
+    m_x = m_ldlt.solve(m_rhs);
+    for (int i = 0; i < n; ++i) {
+        x[m_rows[i]] = QVector3D(m_x(i, 0), m_x(i, 1), m_x(i, 2));
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef PROJECTIVEDYNAMICS_H
+#define PROJECTIVEDYNAMICS_H
+
+#include <vector>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include "../Constraints/linkconstraints.h"
+
+// Projective Dynamics (Bouaziz et al. 2014) over the cloth links. Every
+// link is a spring towards its projection onto the rest length. The local
+// step projects all links independently, the global step solves
+//     (M / h^2 + sum k A^T A) x = M / h^2 s + sum k A^T p
+// for the moving particles. The matrix only depends on the links, pins and
+// step size, so it is factored once and every iteration is a back
+// substitution.
+class ProjectiveSolver
+{
+public:
+    // Assembles and factors the system. Link indices are kept, so this has
+    // to run again whenever links are added, removed or reordered, or pins
+    // or the step size change.
+    void factor(const ParticleStore& particles, const std::vector<LinkConstraint>& links, float dt);
+
+    // Takes the inertial prediction in particles.position as the target
+    // the iterations are pulled towards
+    void begin(const ParticleStore& particles);
+
+    // One local and global step. Links stretched past their elongation
+    // ratio are marked broken and added to torn.
+    void iterate(ParticleStore& particles, std::vector<LinkConstraint>& links, BrokenLinks& torn);
+
+    // Exact match, the cloth steps with a fixed dt
+    bool factored(float dt) const
+    {
+        return m_valid && m_dt == dt;
+    }
+
+    // 1 / compliance, with the rigid links capped so the system stays well
+    // conditioned
+    static float stiffness(const LinkConstraint& l)
+    {
+        return 1.0f / std::max(l.compliance, 1e-7f);
+    }
+
+private:
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> m_ldlt;
+    Eigen::Matrix<double, Eigen::Dynamic, 3>           m_rhs;
+    Eigen::Matrix<double, Eigen::Dynamic, 3>           m_x;
+
+    std::vector<int>       m_rows;        // row -> particle
+    std::vector<int>       m_offsets;     // row -> first entry in m_incident
+    std::vector<int>       m_incident;    // 2 * link + 1 when the row is particle_2
+    std::vector<float>     m_stiffness;   // per link
+    std::vector<QVector3D> m_projections; // per link, of particle_1 - particle_2
+    std::vector<QVector3D> m_inertial;    // per row
+    float                  m_dt    = 0.0f;
+    bool                   m_valid = false;
+};
+
+#endif // PROJECTIVEDYNAMICS_H
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "DetectCollisoin.h"
+#include "../algo/bvh.h"
+
+#include <algorithm>
+
+namespace physE {
+namespace impl {
+
+    // Dynamic bodies are swept and pruned along x; the sorted order is kept
+    // between steps, so the insertion sort that restores it is close to
+    // linear while bodies move coherently.
+    //
+    // Static and kinematic bodies live in their own BVH that only dynamic
+    // bodies query, so static-static, static-kinematic and
+    // kinematic-kinematic pairs are never generated. The tree is rebuilt
+    // only when that set changes (or after InvalidateStatic when a static
+    // body was moved by hand) and refitted when kinematic bodies move.
+    // Unbounded statics (planes) are paired with every dynamic body.
+    //
+    // Every candidate goes through Object::ShouldCollide before the box test.
+    //
+    // Scene queries use the static tree plus a second BVH over the dynamic
+    // bodies that PrepareQueries rebuilds after InvalidateQueries. Once
+    // prepared, the Query functions are const and may run on many threads.
+    class Broadphase
+    {
+    public:
+        void InvalidateStatic()
+        {
+            m_staticDirty = true;
+        }
+
+        void InvalidateQueries()
+        {
+            m_queryDirty = true;
+        }
+
+        void FindPairs(const QVector<Object*>& objects, FrameVector<CollisionPair>& pairs)
+        {
+            Partition(objects);
+            UpdateStatic();
+            UpdateDynamic();
+
+            const int n = m_dynamic.size();
+            for (int i = 0; i < n; i++) {
+                const int a = m_order[i];
+                const AABB& boxA = m_boxes[a];
+                if (boxA.IsEmpty()) continue;
+
+                for (int j = i + 1; j < n; j++) {
+                    const int b = m_order[j];
+                    const AABB& boxB = m_boxes[b];
+                    if (boxB.Min.x() > boxA.Max.x()) break;
+
+                    AddPair(m_dynamic[a], m_dynamic[b], boxA, boxB, pairs);
+                }
+
+                m_staticTree.Query(boxA, [&](int s) {
+                    AddPair(m_dynamic[a], m_staticSet[s], boxA, m_staticBoxes[s], pairs);
+                });
+                for (Object* plane : m_unbounded) {
+                    if (Object::ShouldCollide(m_dynamic[a], plane)) {
+                        pairs.push_back({m_dynamic[a], plane});
+                    }
+                }
+            }
+        }
+
+        static void AddPair(
+            Object* a, Object* b,
+            const AABB& boxA, const AABB& boxB,
+            FrameVector<CollisionPair>& pairs)
+        {
+            if (!Object::ShouldCollide(a, b)) return;
+            if (!boxA.Overlaps(boxB)) return;
+
+            pairs.push_back({a, b});
+        }
+
+        void PrepareQueries(const QVector<Object*>& objects)
+        {
+            if (!m_queryDirty) return;
+            m_queryDirty = false;
+
+            Partition(objects);
+            UpdateStatic();
+
+            m_queryObjects = m_dynamic;
+            m_queryBoxes.resize(m_dynamic.size());
+            for (size_t i = 0; i < m_dynamic.size(); i++) {
+                m_queryBoxes[i] = m_dynamic[i]->Collider->GetAABB(m_dynamic[i]->Transform);
+            }
+            m_queryTree.Build(m_queryBoxes, 1);
+        }
+
+        // Calls visit(object, maxT) for every object whose box the segment
+        // origin + t * direction, 0 <= t <= maxT, touches; bounded objects
+        // roughly front to back. visit may lower maxT.
+        template<typename F>
+        void QueryRay(const QVector3D& origin, const QVector3D& direction, float maxT, F&& visit) const
+        {
+            for (Object* plane : m_unbounded) {
+                visit(plane, maxT);
+            }
+            m_staticTree.Raycast(origin, direction, maxT, [&](int i, float& treeMaxT) {
+                visit(m_staticSet[i], maxT);
+                treeMaxT = maxT;
+            });
+            m_queryTree.Raycast(origin, direction, maxT, [&](int i, float& treeMaxT) {
+                visit(m_queryObjects[i], maxT);
+                treeMaxT = maxT;
+            });
+        }
+
+        // Calls visit(object) for every object whose box overlaps box
+        template<typename F>
+        void QueryBox(const AABB& box, F&& visit) const
+        {
+            for (Object* plane : m_unbounded) {
+                visit(plane);
+            }
+            m_staticTree.Query(box, [&](int i) {
+                visit(m_staticSet[i]);
+            });
+            m_queryTree.Query(box, [&](int i) {
+                visit(m_queryObjects[i]);
+            });
+        }
+
+    private:
+        void Partition(const QVector<Object*>& objects)
+        {
+            m_dynamic.clear();
+            m_static.clear();
+            for (Object* obj : objects) {
+                if (!obj->Collider) continue;
+                (obj->IsDynamic ? m_dynamic : m_static).push_back(obj);
+            }
+        }
+
+        void UpdateStatic()
+        {
+            if (m_static != m_staticLast) {
+                m_staticLast = m_static;
+                m_staticDirty = true;
+            }
+
+            if (m_staticDirty) {
+                m_staticDirty = false;
+                m_staticSet.clear();
+                m_staticBoxes.clear();
+                m_kinematic.clear();
+                m_unbounded.clear();
+                for (Object* obj : m_static) {
+                    AABB box = obj->Collider->GetAABB(obj->Transform);
+                    if (box.IsInfinite()) {
+                        m_unbounded.push_back(obj);
+                        continue;
+                    }
+                    if (obj->IsKinematic) {
+                        m_kinematic.push_back(m_staticSet.size());
+                    }
+                    m_staticSet.push_back(obj);
+                    m_staticBoxes.push_back(box);
+                }
+                m_staticTree.Build(m_staticBoxes, 1);
+                return;
+            }
+
+            if (m_kinematic.empty()) return;
+            for (int k : m_kinematic) {
+                Object* obj = m_staticSet[k];
+                m_staticBoxes[k] = obj->Collider->GetAABB(obj->Transform);
+            }
+            m_staticTree.Refit(m_staticBoxes);
+        }
+
+        void UpdateDynamic()
+        {
+            const int n = m_dynamic.size();
+            m_boxes.resize(n);
+            for (int i = 0; i < n; i++) {
+                m_boxes[i] = m_dynamic[i]->Collider->GetAABB(m_dynamic[i]->Transform);
+            }
+
+            // a changed set starts from scratch, the insertion sort below
+            // is only cheap on last step's nearly sorted order
+            if (m_dynamic != m_dynamicLast) {
+                m_dynamicLast = m_dynamic;
+                m_order.resize(n);
+                for (int i = 0; i < n; i++) {
+                    m_order[i] = i;
+                }
+                std::sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+                    return m_boxes[a].Min.x() < m_boxes[b].Min.x();
+                });
+                return;
+            }
+
+            for (int i = 1; i < n; i++) {
+                int key = m_order[i];
+                float x = m_boxes[key].Min.x();
+                int j = i - 1;
+                while (j >= 0 && m_boxes[m_order[j]].Min.x() > x) {
+                    m_order[j + 1] = m_order[j];
+                    j--;
+                }
+                m_order[j + 1] = key;
+            }
+        }
+
+        // dynamic bodies
+        std::vector<Object*> m_dynamic;
+        std::vector<Object*> m_dynamicLast;
+        std::vector<AABB>    m_boxes;
+        std::vector<int>     m_order;
+
+        // static and kinematic bodies
+        std::vector<Object*> m_static;
+        std::vector<Object*> m_staticLast;
+        std::vector<Object*> m_staticSet;   // bounded ones, indexed by the tree
+        std::vector<AABB>    m_staticBoxes;
+        std::vector<int>     m_kinematic;   // into m_staticSet
+        std::vector<Object*> m_unbounded;
+        BVH  m_staticTree;
+        bool m_staticDirty = true;
+
+        // dynamic bodies as of the last PrepareQueries
+        std::vector<Object*> m_queryObjects;
+        std::vector<AABB>    m_queryBoxes;
+        BVH  m_queryTree;
+        bool m_queryDirty = true;
+    };
+
+}
+}
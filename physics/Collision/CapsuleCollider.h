@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Collider.h"
+#include <cmath>
+
+namespace physE {
+namespace impl {
+
+    // Capsule along the local y axis: a segment of length 2 * HalfHeight
+    // through Center, swept by a sphere of Radius.
+    struct CapsuleCollider final
+        : Collider
+    {
+    public:
+        QVector3D Center;
+        float HalfHeight;
+        float Radius;
+
+        std::vector<VerNorm> m_data;
+        std::vector<int> m_index;
+
+        QOpenGLVertexArrayObject VAO;
+        QOpenGLBuffer VBO;
+
+        CapsuleCollider()
+            : Collider(ColliderType::CAPSULE)
+            , Center()
+            , HalfHeight(1.0f)
+            , Radius(0.5f)
+        {
+
+        }
+
+        CapsuleCollider(QVector3D center, float halfHeight, float radius)
+            : Collider(ColliderType::CAPSULE)
+            , Center(center)
+            , HalfHeight(halfHeight)
+            , Radius(radius)
+        {
+
+        }
+
+        // World space end points of the inner segment
+        void Segment(
+            Transform* transform,
+            QVector3D& p0,
+            QVector3D& p1) const
+        {
+            QVector3D axis = transform->Rotation.mapVector(QVector3D(0, HalfHeight, 0));
+            QVector3D center = transform->Rotation.mapVector(Center) + transform->Position;
+            p0 = center - axis;
+            p1 = center + axis;
+        }
+
+        QVector3D FindFurthestPoint(
+            Transform* transform,
+            const QVector3D& direction) const override
+        {
+            QVector3D p0, p1;
+            Segment(transform, p0, p1);
+
+            QVector3D end = QVector3D::dotProduct(p1 - p0, direction) > 0 ? p1 : p0;
+            return end + Radius * direction.normalized();
+        }
+
+        void BuildMesh(int slices = 16, int rings = 8)
+        {
+            m_data.clear();
+            m_index.clear();
+
+            const float pi = 3.14159265f;
+            // two hemispheres, each from its pole down to the equator
+            for (int h = 0; h < 2; h++) {
+                float offset = h == 0 ? HalfHeight : -HalfHeight;
+                for (int i = 0; i <= rings; i++) {
+                    float phi = pi * 0.5f * (h + float(i) / rings);
+                    for (int j = 0; j <= slices; j++) {
+                        float theta = 2 * pi * float(j) / slices;
+                        QVector3D norm(
+                            std::sin(phi) * std::cos(theta),
+                            std::cos(phi),
+                            std::sin(phi) * std::sin(theta));
+                        VerNorm vn(Center + QVector3D(0, offset, 0) + Radius * norm);
+                        vn.Norm = norm;
+                        m_data.push_back(vn);
+                    }
+                }
+            }
+
+            const int rows = 2 * (rings + 1);
+            const int stride = slices + 1;
+            for (int i = 0; i + 1 < rows; i++) {
+                for (int j = 0; j < slices; j++) {
+                    int a = i * stride + j;
+                    int b = a + stride;
+                    m_index.insert(m_index.end(), {a, b, a + 1, a + 1, b, b + 1});
+                }
+            }
+        }
+
+        void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram, Transform* transform) override
+        {
+            QMatrix4x4 model;
+            model.translate(transform->Position);
+            model *= transform->Rotation;
+            shaderProgram->setUniformValue("model", model);
+            if(VAO.objectId() == 0)
+            {
+                if (m_data.empty()) {
+                    BuildMesh();
+                }
+
+                VAO.create();
+                VAO.bind();
+                VBO = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+                QOpenGLBuffer ebo(QOpenGLBuffer::IndexBuffer);
+                VBO.create();
+                ebo.create();
+                VBO.bind();
+                VBO.allocate(m_data.data(), m_data.size() * sizeof(VerNorm));
+                ebo.bind();
+                ebo.allocate(&m_index[0], m_index.size() * sizeof(unsigned int));
+
+                shaderProgram->enableAttributeArray(0);
+                shaderProgram->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(VerNorm));
+                shaderProgram->enableAttributeArray(1);
+                shaderProgram->setAttributeBuffer(1, GL_FLOAT, offsetof(VerNorm, Norm), 3, sizeof(VerNorm));
+                VAO.release();
+            }
+
+            QOpenGLVertexArrayObject::Binder bind(&VAO);
+            glFunc->glDrawElements(GL_TRIANGLES, m_index.size(), GL_UNSIGNED_INT, 0);
+        }
+    };
+
+}
+}
+using namespace physE;
@@ -15,6 +15,7 @@
 #include <QOpenGLTexture>
 #include <QOpenGLWidget>
 #include <QtOpenGLExtensions/QOpenGLExtensions>
+#include "../algo/aabb.h"
 
 namespace physE {
 
@@ -30,9 +31,13 @@ namespace physE {
         SPHERE,
         CAPSULE,
         HULL,
-        MESH
+        MESH,
+        HEIGHTFIELD,
+        COMPOUND
     };
 
+    constexpr size_t ColliderTypeCount = (size_t)ColliderType::COMPOUND + 1;
+
 
 
     struct Transform { // Describes an objects location
@@ -41,6 +46,35 @@ namespace physE {
         QMatrix4x4 Rotation;
     };
 
+    // Box around a local space box after the transform (scale not applied)
+    inline AABB ToWorld(Transform* transform, const AABB& box)
+    {
+        AABB world;
+        for (int i = 0; i < 8; i++) {
+            QVector3D corner(
+                i & 1 ? box.Max.x() : box.Min.x(),
+                i & 2 ? box.Max.y() : box.Min.y(),
+                i & 4 ? box.Max.z() : box.Min.z());
+            world.Expand(transform->Rotation.mapVector(corner) + transform->Position);
+        }
+        return world;
+    }
+
+    // Box around a world space box in the transform's local frame
+    inline AABB ToLocal(Transform* transform, const AABB& box)
+    {
+        QMatrix4x4 inverse = transform->Rotation.transposed();
+        AABB local;
+        for (int i = 0; i < 8; i++) {
+            QVector3D corner(
+                i & 1 ? box.Max.x() : box.Min.x(),
+                i & 2 ? box.Max.y() : box.Min.y(),
+                i & 4 ? box.Max.z() : box.Min.z());
+            local.Expand(inverse.mapVector(corner - transform->Position));
+        }
+        return local;
+    }
+
     struct VerNorm
     {
         QVector3D Vertex;
@@ -66,6 +100,18 @@ namespace physE {
             Transform* transform,
             const QVector3D& direction) const = 0;
 
+        // World space bounds; convex colliders get them from six support queries
+        virtual AABB GetAABB(Transform* transform) const
+        {
+            return AABB(
+                QVector3D(FindFurthestPoint(transform, QVector3D(-1, 0, 0)).x(),
+                          FindFurthestPoint(transform, QVector3D(0, -1, 0)).y(),
+                          FindFurthestPoint(transform, QVector3D(0, 0, -1)).z()),
+                QVector3D(FindFurthestPoint(transform, QVector3D(1, 0, 0)).x(),
+                          FindFurthestPoint(transform, QVector3D(0, 1, 0)).y(),
+                          FindFurthestPoint(transform, QVector3D(0, 0, 1)).z()));
+        }
+
         virtual void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram, Transform* transform) = 0;
     };
 
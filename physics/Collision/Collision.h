@@ -2,6 +2,7 @@
 
 #include "CollisionPoints.h"
 #include "CollisionObject.h"
+#include "../algo/arena.h"
 
 namespace physE {
     struct Collision {
@@ -16,4 +17,16 @@ namespace physE {
 
         }
     };
+
+    struct TriggerEvent {
+        enum Type {
+            Begin,
+            Stay,
+            End
+        };
+
+        Type Kind;
+        Object* Trigger;
+        Object* Other;
+    };
 }
@@ -1,28 +1,47 @@
 #pragma once
 
+#include <cmath>
 #include "Collider.h"
 
 namespace physE {
     struct Collision;
+
+    // Mass, center of mass and inertia tensor about it, in the collider's frame
+    struct MassProperties {
+        float Mass = 0;
+        QVector3D CenterOfMass;
+        QMatrix4x4 Inertia; // upper 3x3 is the tensor
+    };
+
     struct Object {
-        int idx;        
+        int idx = -1;   // slot in the owning ObjectPool, set by it
         QVector3D Velocity;
         QVector3D Force;
         float Mass;
-        float I; //转动惯量
+        QVector3D CenterOfMass = QVector3D();      // local
+        QMatrix4x4 InvInertiaLocal = InvInertia(100);
+        QMatrix4x4 InvInertiaWorld = InvInertia(100); // 转动惯量, refreshed by UpdateInertia
 
         // Angular components
         float orientation = 0; // radians
         QVector3D angularVelocity = QVector3D();
         QVector3D torque = QVector3D();
 
-        Collider* Collider;
-        Transform* Transform;
+        Collider* Collider = nullptr;   // shared, not owned
+        Transform* Transform = nullptr; // owned
 
-        bool IsTrigger;
+        bool IsTrigger = false; // overlap events only, never contacts
+        bool IsKinematic = false; // moved by Velocity and angularVelocity only, infinite mass
         bool IsStatic;
         const bool IsDynamic;
 
+        // Collision filter: A and B collide when each one's Category is in
+        // the other's Mask. A shared non zero Group overrides that, positive
+        // groups always collide and negative ones never do.
+        quint32 Category = 0x1;
+        quint32 Mask = 0xFFFFFFFF;
+        int Group = 0;
+
         Object(bool _IsDynamic = false)
             : IsTrigger(false)
             , IsStatic(!_IsDynamic)
@@ -31,53 +50,47 @@ namespace physE {
 
         }
 
-        Object(int _idx, QVector3D pos, bool _IsDynamic = false): idx(_idx), IsDynamic(_IsDynamic)
+        Object(QVector3D pos, bool _IsDynamic = false): IsDynamic(_IsDynamic)
         {
             Velocity = QVector3D(0, 0, 0);
             Force = QVector3D(0, 0, 0);
             Mass = 1;
-            I = 10;
             Transform = new struct Transform();
             Transform->Position = pos;
             Transform->Rotation = QMatrix4x4();
             Transform->Scale = QVector3D(1, 1, 1);
         }
 
-        Object(int _idx, QVector3D pos, QVector3D vel, bool _IsDynamic = false): idx(_idx), Velocity(vel), IsDynamic(_IsDynamic)
+        Object(QVector3D pos, QVector3D vel, bool _IsDynamic = false): Velocity(vel), IsDynamic(_IsDynamic)
         {
             Force = QVector3D(0, 0, 0);
             Mass = 1;
-            I = 100;
             Transform = new struct Transform();
             Transform->Position = pos;
             Transform->Rotation = QMatrix4x4();
             Transform->Scale = QVector3D(1, 1, 1);
         }
 
-        Object(int _idx, QVector3D pos, QVector3D vel, struct Collider* _Collider, bool _IsDynamic = false)
-            : idx(_idx)
-            , Velocity(vel)
+        Object(QVector3D pos, QVector3D vel, struct Collider* _Collider, bool _IsDynamic = false)
+            : Velocity(vel)
             , Collider(_Collider)
             , IsDynamic(_IsDynamic)
         {
             Force = QVector3D(0, 0, 0);
             Mass = 1;
-            I = 100;
             Transform = new struct Transform();
             Transform->Position = pos;
             Transform->Rotation = QMatrix4x4();
             Transform->Scale = QVector3D(1, 1, 1);
         }
 
-        Object(int _idx, QVector3D pos, QVector3D vel, struct Collider* _Collider, struct Transform* _tran, bool _IsDynamic = false)
-            : idx(_idx)
-            , Velocity(vel)
+        Object(QVector3D pos, QVector3D vel, struct Collider* _Collider, struct Transform* _tran, bool _IsDynamic = false)
+            : Velocity(vel)
             , Collider(_Collider)
             , IsDynamic(_IsDynamic)
         {
             Force = QVector3D(0, 0, 0);
             Mass = 1;
-            I = 100;
             Transform = _tran;
             Transform = new struct Transform();
             Transform->Position = pos;
@@ -85,9 +98,8 @@ namespace physE {
             Transform->Scale = QVector3D(1, 1, 1);
         }
 
-        Object(int _idx, struct Collider* _Collider, bool _IsDynamic = false)
-            : idx(_idx)
-            , Collider(_Collider)
+        Object(struct Collider* _Collider, bool _IsDynamic = false)
+            : Collider(_Collider)
             , IsDynamic(_IsDynamic)
         {
             Transform = new struct Transform();
@@ -96,6 +108,58 @@ namespace physE {
             Transform->Scale = QVector3D(1, 1, 1);
         }
 
+        ~Object()
+        {
+            delete Transform;
+        }
+
+        Object(const Object&) = delete;
+        Object& operator = (const Object&) = delete;
+
+        static QMatrix4x4 InvInertia(float i)
+        {
+            QMatrix4x4 m;
+            m(0, 0) = m(1, 1) = m(2, 2) = 1.0f / i;
+            return m;
+        }
+
+        // Open or degenerate shapes come out with no mass or a singular
+        // tensor, those are refused and the object keeps what it had
+        bool SetMassProperties(const MassProperties& props)
+        {
+            bool invertible = false;
+            const QMatrix4x4 invInertia = props.Inertia.inverted(&invertible);
+            if (!(props.Mass > 0) || !std::isfinite(props.Mass) || !invertible) {
+                return false;
+            }
+            Mass = props.Mass;
+            CenterOfMass = props.CenterOfMass;
+            InvInertiaLocal = invInertia;
+            InvInertiaLocal(3, 3) = 1;
+            UpdateInertia();
+            return true;
+        }
+
+        // R * I^-1 * R^T, call whenever the rotation changed
+        void UpdateInertia()
+        {
+            const QMatrix4x4& R = Transform->Rotation;
+            InvInertiaWorld = R * InvInertiaLocal * R.transposed();
+        }
+
+        QVector3D WorldCenterOfMass() const
+        {
+            return Transform->Rotation.mapVector(CenterOfMass) + Transform->Position;
+        }
+
+        static bool ShouldCollide(const Object* a, const Object* b)
+        {
+            if (a->Group != 0 && a->Group == b->Group) {
+                return a->Group > 0;
+            }
+            return (a->Category & b->Mask) && (b->Category & a->Mask);
+        }
+
         QVector3D operator + (Object &b)
         {
             return Transform->Position + b.Transform->Position;
@@ -15,7 +15,7 @@ namespace physE
         bool HasCollision;
 
         CollisionPoints()
-            : A(), B(), Normal(), Depth(), ContactPoint()
+            : A(), B(), Normal(), Depth(), ContactPoint(), HasCollision(false)
         {}
 
         CollisionPoints(QVector3D a, QVector3D b, QVector3D normal, float distance, bool hasCollision)
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Collider.h"
+#include "../algo/bvh.h"
+
+namespace physE {
+namespace impl {
+
+    struct CompoundChild
+    {
+        Collider* Shape;
+        Transform Local;
+    };
+
+    // Union of child colliders placed with local transforms, moving as one
+    // body. A small BVH over the children's local boxes lets pair tests
+    // descend only into the children under the other shape.
+    struct CompoundCollider final
+        : Collider
+    {
+        std::vector<CompoundChild> m_children;
+        BVH m_bvh;
+
+        CompoundCollider()
+            : Collider(ColliderType::COMPOUND)
+        {
+
+        }
+
+        // Call Build() once all children are added
+        void AddChild(Collider* shape, QVector3D position, QMatrix4x4 rotation = QMatrix4x4())
+        {
+            CompoundChild child;
+            child.Shape = shape;
+            child.Local.Position = position;
+            child.Local.Rotation = rotation;
+            child.Local.Scale = QVector3D(1, 1, 1);
+            m_children.push_back(child);
+        }
+
+        void Build()
+        {
+            std::vector<AABB> bounds(m_children.size());
+            for (size_t i = 0; i < m_children.size(); i++) {
+                CompoundChild& child = m_children[i];
+                bounds[i] = child.Shape->GetAABB(&child.Local);
+            }
+            m_bvh.Build(bounds, 1);
+        }
+
+        // World transform of child i
+        Transform ChildTransform(Transform* transform, int i) const
+        {
+            const Transform& local = m_children[i].Local;
+            Transform world;
+            world.Position = transform->Rotation.mapVector(local.Position) + transform->Position;
+            world.Rotation = transform->Rotation * local.Rotation;
+            world.Scale = transform->Scale;
+            return world;
+        }
+
+        // Calls visit(child) for the children whose local box overlaps box
+        template<typename F>
+        void QueryChildren(Transform* transform, const AABB& box, F&& visit) const
+        {
+            if (box.IsInfinite()) {
+                for (size_t i = 0; i < m_children.size(); i++) {
+                    visit(int(i));
+                }
+                return;
+            }
+            m_bvh.Query(ToLocal(transform, box), std::forward<F>(visit));
+        }
+
+        QVector3D FindFurthestPoint(
+            Transform* transform,
+            const QVector3D& direction) const override
+        {
+            QVector3D furthestPoint;
+            float maxDistance = -FLT_MAX;
+            for (size_t i = 0; i < m_children.size(); i++) {
+                Transform t = ChildTransform(transform, i);
+                QVector3D p = m_children[i].Shape->FindFurthestPoint(&t, direction);
+                float distance = QVector3D::dotProduct(p, direction);
+                if (distance > maxDistance) {
+                    maxDistance = distance;
+                    furthestPoint = p;
+                }
+            }
+            return furthestPoint;
+        }
+
+        AABB GetAABB(Transform* transform) const override
+        {
+            return ToWorld(transform, m_bvh.Bounds());
+        }
+
+        void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram, Transform* transform) override
+        {
+            for (size_t i = 0; i < m_children.size(); i++) {
+                Transform t = ChildTransform(transform, i);
+                m_children[i].Shape->Draw(glFunc, shaderProgram, &t);
+            }
+        }
+    };
+
+}
+}
+using namespace physE;
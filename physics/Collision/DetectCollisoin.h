@@ -4,6 +4,10 @@
 #include "SphereCollider.h"
 #include "PlaneCollider.h"
 #include "HullCollider.h"
+#include "CapsuleCollider.h"
+#include "MeshCollider.h"
+#include "HeightfieldCollider.h"
+#include "CompoundCollider.h"
 #include "GJK.h"
 
 namespace physE {
@@ -12,7 +16,7 @@ namespace impl {
         Collider*, Transform*,
         Collider*, Transform*);
 
-    CollisionPoints Test_Plane_Sphere(
+    inline CollisionPoints Test_Plane_Sphere(
         Collider* a, Transform* at,
         Collider* b, Transform* bt)
     {
@@ -44,7 +48,29 @@ namespace impl {
         return res;
     }
 
-    CollisionPoints Test_Sphere_Sphere(
+    // Closed-form contact between two spheres; the capsule tests reduce to it
+    // once the closest points of their inner segments are known.
+    inline CollisionPoints SphereContact(
+        const QVector3D& acenter, float aRadius,
+        const QVector3D& bcenter, float bRadius)
+    {
+        CollisionPoints res;
+        QVector3D ab = bcenter - acenter;
+        float radius = aRadius + bRadius;
+        float distance2 = ab.lengthSquared();
+        if(distance2 <= radius * radius)
+        {
+            // coincident centers have no contact plane, push apart along y
+            res.Normal = distance2 > 0 ? ab / std::sqrt(distance2) : QVector3D(0, 1, 0);
+            res.A = acenter + aRadius*res.Normal;
+            res.B = bcenter - bRadius*res.Normal;
+            res.Depth = (res.A - res.B).length();
+            res.HasCollision = true;
+        }
+        return res;
+    }
+
+    inline CollisionPoints Test_Sphere_Sphere(
         Collider* a, Transform* at,
         Collider* b, Transform* bt)
     {
@@ -54,24 +80,157 @@ namespace impl {
         Sphere* A = (Sphere*)a;
         Sphere* B = (Sphere*)b;
 
-        CollisionPoints res;
-        QVector3D acenter = A->Center + at->Position;
-        QVector3D bcenter = B->Center + bt->Position;
-        QVector3D ab = bcenter - acenter;
-        float distance = ab.length();
-        if(distance <= A->Radius + B->Radius)
-        {
-            //qDebug()<<distance<<"<="<<Radius<<" + "<<sphere->Radius;
-            res.Normal = ab.normalized();
-            res.A = acenter + A->Radius*res.Normal;
-            res.B = bcenter - B->Radius*res.Normal;
-            res.Depth = (res.A - res.B).length();
-            res.HasCollision = true;
+        return SphereContact(
+            A->Center + at->Position, A->Radius * major(at->Scale),
+            B->Center + bt->Position, B->Radius * major(bt->Scale));
+    }
+
+    inline QVector3D ClosestPointOnSegment(
+        const QVector3D& p,
+        const QVector3D& a, const QVector3D& b)
+    {
+        QVector3D ab = b - a;
+        float denom = ab.lengthSquared();
+        if (denom <= 0) {
+            return a;
+        }
+        float t = QVector3D::dotProduct(p - a, ab) / denom;
+        t = std::min(std::max(t, 0.0f), 1.0f);
+        return a + t * ab;
+    }
+
+    // Closest points between segments p1q1 and p2q2 (Ericson, RTCD 5.1.9)
+    inline void ClosestPointsSegmentSegment(
+        const QVector3D& p1, const QVector3D& q1,
+        const QVector3D& p2, const QVector3D& q2,
+        QVector3D& c1, QVector3D& c2)
+    {
+        const float eps = 1e-8f;
+        QVector3D d1 = q1 - p1;
+        QVector3D d2 = q2 - p2;
+        QVector3D r  = p1 - p2;
+        float a = d1.lengthSquared();
+        float e = d2.lengthSquared();
+        float f = QVector3D::dotProduct(d2, r);
+
+        float s = 0;
+        float t = 0;
+        if (a <= eps && e <= eps) {
+            c1 = p1;
+            c2 = p2;
+            return;
+        }
+        if (a <= eps) {
+            t = std::min(std::max(f / e, 0.0f), 1.0f);
+        }
+        else {
+            float c = QVector3D::dotProduct(d1, r);
+            if (e <= eps) {
+                s = std::min(std::max(-c / a, 0.0f), 1.0f);
+            }
+            else {
+                float b = QVector3D::dotProduct(d1, d2);
+                float denom = a * e - b * b;
+                s = denom != 0 ? std::min(std::max((b * f - c * e) / denom, 0.0f), 1.0f) : 0;
+                t = (b * s + f) / e;
+                if (t < 0) {
+                    t = 0;
+                    s = std::min(std::max(-c / a, 0.0f), 1.0f);
+                }
+                else if (t > 1) {
+                    t = 1;
+                    s = std::min(std::max((b - c) / a, 0.0f), 1.0f);
+                }
+            }
+        }
+        c1 = p1 + d1 * s;
+        c2 = p2 + d2 * t;
+    }
+
+    inline CollisionPoints Test_Plane_Capsule(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Plane   = PlaneCollider;
+        using Capsule = CapsuleCollider;
+
+        Plane*   A = (Plane*)a;
+        Capsule* B = (Capsule*)b;
+
+        QVector3D normal = A->Normal.normalized();
+        QVector3D plane  = normal * A->Distance + at->Position;
+
+        QVector3D p0, p1;
+        B->Segment(bt, p0, p1);
+
+        // signed separation of each end cap from the plane
+        float d0 = QVector3D::dotProduct(p0 - plane, normal) - B->Radius;
+        float d1 = QVector3D::dotProduct(p1 - plane, normal) - B->Radius;
+        if (d0 > 0 && d1 > 0) {
+            return CollisionPoints();
+        }
+
+        float distance = -std::min(d0, d1);
+        QVector3D end = d0 < d1 ? p0 : p1;
+        QVector3D bDeep = end - normal * B->Radius;
+
+        // lying on the plane: contact under the middle of the segment
+        if (d0 <= 0 && d1 <= 0) {
+            end = (p0 + p1) * 0.5f;
+        }
+
+        CollisionPoints point = CollisionPoints(plane, bDeep, normal, distance, true);
+        point.ContactPoint = end - normal * QVector3D::dotProduct(end - plane, normal);
+        return point;
+    }
+
+    inline CollisionPoints Test_Sphere_Capsule(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Sphere  = SphereCollider;
+        using Capsule = CapsuleCollider;
+
+        Sphere*  A = (Sphere*)a;
+        Capsule* B = (Capsule*)b;
+
+        QVector3D center = A->Center + at->Position;
+        QVector3D p0, p1;
+        B->Segment(bt, p0, p1);
+
+        CollisionPoints res = SphereContact(
+            center, A->Radius,
+            ClosestPointOnSegment(center, p0, p1), B->Radius);
+        if (res.HasCollision) {
+            res.ContactPoint = (res.A + res.B) * 0.5f;
         }
         return res;
     }
 
-    CollisionPoints Test_Plane_Hull(
+    inline CollisionPoints Test_Capsule_Capsule(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Capsule = CapsuleCollider;
+
+        Capsule* A = (Capsule*)a;
+        Capsule* B = (Capsule*)b;
+
+        QVector3D a0, a1, b0, b1;
+        A->Segment(at, a0, a1);
+        B->Segment(bt, b0, b1);
+
+        QVector3D ca, cb;
+        ClosestPointsSegmentSegment(a0, a1, b0, b1, ca, cb);
+
+        CollisionPoints res = SphereContact(ca, A->Radius, cb, B->Radius);
+        if (res.HasCollision) {
+            res.ContactPoint = (res.A + res.B) * 0.5f;
+        }
+        return res;
+    }
+
+    inline CollisionPoints Test_Plane_Hull(
         Collider* a, Transform* at,
         Collider* b, Transform* bt)
     {
@@ -107,13 +266,11 @@ namespace impl {
 
     }
 
-    CollisionPoints Test_GJK(
-        Collider* a, Transform* at,
-        Collider* b, Transform* bt)
+    template<typename ColliderA, typename ColliderB>
+    CollisionPoints ConvexContact(
+        const ColliderA* A, Transform* at,
+        const ColliderB* B, Transform* bt)
     {
-        Collider* A = (Collider*)a;
-        Collider* B = (Collider*)b;
-
         //auto [collision, simplex] = GJK(A, at, B, bt);
         auto Pair = GJK(A, at, B, bt);
         bool collision = std::get<0>(Pair);
@@ -122,33 +279,398 @@ namespace impl {
 
         if(collision)
         {
-//            qDebug()<<"111111111111";
-//            for(int i = 0; i < 4; i++)
-//            {
-//                qDebug()<<simplex[i];
-//            }
-//            qDebug()<<"111111111111";
             return EPA(simplex, A, at, B, bt);
         }
         return CollisionPoints();
     }
 
+    template<typename ColliderA, typename ColliderB>
+    CollisionPoints Test_GJK(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        return ConvexContact(
+            static_cast<const ColliderA*>(a), at,
+            static_cast<const ColliderB*>(b), bt);
+    }
+
+    // Rounded shapes are tested as their core (the sphere center, the capsule
+    // segment) plus a margin of one radius. GJK distance gives the contact
+    // directly while the core is outside the other shape; only deep
+    // penetration, where the core itself overlaps, falls back to EPA.
+    struct SphereCore
+    {
+        QVector3D Center;
+
+        QVector3D FindFurthestPoint(
+            Transform* /*transform*/,
+            const QVector3D& /*direction*/) const
+        {
+            return Center;
+        }
+    };
+
+    struct SegmentCore
+    {
+        QVector3D P0;
+        QVector3D P1;
+
+        QVector3D FindFurthestPoint(
+            Transform* /*transform*/,
+            const QVector3D& direction) const
+        {
+            return QVector3D::dotProduct(P1 - P0, direction) > 0 ? P1 : P0;
+        }
+    };
+
+    template<typename Core, typename ColliderA, typename ColliderB>
+    CollisionPoints CoreContact(
+        const Core& core, float radius,
+        const ColliderA* A, Transform* at,
+        const ColliderB* B, Transform* bt)
+    {
+        QVector3D onCore;
+        QVector3D onB;
+        float distance;
+        if (!GJKDistance(&core, at, B, bt, onCore, onB, distance)) {
+            return ConvexContact(A, at, B, bt);
+        }
+
+        if (distance > radius) {
+            return CollisionPoints();
+        }
+
+        CollisionPoints res;
+        res.Normal = (onB - onCore) / distance;
+        res.A = onCore + res.Normal * radius;
+        res.B = onB;
+        res.Depth = radius - distance;
+        res.ContactPoint = onB;
+        res.HasCollision = true;
+        return res;
+    }
+
+    inline CollisionPoints Test_Sphere_Hull(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Sphere = SphereCollider;
+
+        Sphere* A = (Sphere*)a;
+
+        SphereCore core;
+        core.Center = A->Center + at->Position;
+        return CoreContact(core, A->Radius * major(at->Scale), A, at, (HullCollider*)b, bt);
+    }
+
+    inline CollisionPoints Test_Capsule_Hull(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Capsule = CapsuleCollider;
+
+        Capsule* A = (Capsule*)a;
+
+        SegmentCore core;
+        A->Segment(at, core.P0, core.P1);
+        return CoreContact(core, A->Radius, A, at, (HullCollider*)b, bt);
+    }
+
+    // Convex shapes against static triangle geometry (meshes, heightfields).
+    // Every triangle under the shape's box is tested on its own, then the
+    // per-triangle contacts are reduced to the deepest one, with normal and
+    // contact point averaged over the contacts that agree with it so faces
+    // shared by several triangles give one stable contact.
+    struct TriangleShape
+    {
+        QVector3D V[3];
+
+        QVector3D FindFurthestPoint(
+            Transform* /*transform*/,
+            const QVector3D& direction) const
+        {
+            float d0 = QVector3D::dotProduct(V[0], direction);
+            float d1 = QVector3D::dotProduct(V[1], direction);
+            float d2 = QVector3D::dotProduct(V[2], direction);
+            if (d0 >= d1 && d0 >= d2) return V[0];
+            return d1 >= d2 ? V[1] : V[2];
+        }
+    };
+
+    inline CollisionPoints ReduceContacts(
+        const FrameVector<CollisionPoints>& contacts)
+    {
+        if (contacts.empty()) {
+            return CollisionPoints();
+        }
+
+        size_t deepest = 0;
+        for (size_t i = 1; i < contacts.size(); i++) {
+            if (contacts[i].Depth > contacts[deepest].Depth) {
+                deepest = i;
+            }
+        }
+
+        CollisionPoints res = contacts[deepest];
+        QVector3D normal;
+        QVector3D point;
+        float weight = 0;
+        for (const CollisionPoints& c : contacts) {
+            if (QVector3D::dotProduct(c.Normal, res.Normal) < 0.9f) continue;
+
+            float w = std::max(c.Depth, 1e-4f);
+            normal += c.Normal * w;
+            point  += c.ContactPoint * w;
+            weight += w;
+        }
+        res.Normal = normal.normalized();
+        res.ContactPoint = point / weight;
+        return res;
+    }
+
+    template<typename Source, typename TriangleTest>
+    CollisionPoints TriangleContacts(
+        const AABB& box,
+        const Source* source, Transform* st,
+        TriangleTest&& test)
+    {
+        FrameVector<CollisionPoints> contacts;
+        source->ForEachTriangle(st, box, [&](const QVector3D v[3]) {
+            TriangleShape tri;
+            tri.V[0] = v[0];
+            tri.V[1] = v[1];
+            tri.V[2] = v[2];
+
+            CollisionPoints c = test(tri);
+            if (c.HasCollision) {
+                contacts.push_back(c);
+            }
+        });
+        return ReduceContacts(contacts);
+    }
+
+    template<typename Source>
+    CollisionPoints Test_Sphere_Triangles(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Sphere = SphereCollider;
+
+        Sphere* A = (Sphere*)a;
+        Source* B = (Source*)b;
+
+        QVector3D center = A->Center + at->Position;
+        float radius = A->Radius * major(at->Scale);
+
+        return TriangleContacts(A->GetAABB(at), B, bt, [&](const TriangleShape& tri) {
+            CollisionPoints res;
+            QVector3D onTri = ClosestPointOnTriangle(center, tri.V[0], tri.V[1], tri.V[2]);
+            QVector3D d = onTri - center;
+            float distance2 = d.lengthSquared();
+            if (distance2 > radius * radius) {
+                return res;
+            }
+
+            float distance = std::sqrt(distance2);
+            if (distance > 1e-6f) {
+                res.Normal = d / distance;
+            }
+            else {
+                // center on the triangle: push out along the face normal
+                res.Normal = -QVector3D::normal(tri.V[1] - tri.V[0], tri.V[2] - tri.V[0]);
+            }
+            res.A = center + res.Normal * radius;
+            res.B = onTri;
+            res.Depth = radius - distance;
+            res.ContactPoint = onTri;
+            res.HasCollision = true;
+            return res;
+        });
+    }
+
+    template<typename Source>
+    CollisionPoints Test_Capsule_Triangles(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Capsule = CapsuleCollider;
+
+        Capsule* A = (Capsule*)a;
+        Source*  B = (Source*)b;
+
+        SegmentCore core;
+        A->Segment(at, core.P0, core.P1);
+
+        return TriangleContacts(A->GetAABB(at), B, bt, [&](const TriangleShape& tri) {
+            return CoreContact(core, A->Radius, A, at, &tri, bt);
+        });
+    }
+
+    template<typename Source>
+    CollisionPoints Test_Hull_Triangles(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Hull = HullCollider;
+
+        Hull*   A = (Hull*)a;
+        Source* B = (Source*)b;
+
+        return TriangleContacts(A->GetAABB(at), B, bt, [&](const TriangleShape& tri) {
+            CollisionPoints res = ConvexContact(A, at, &tri, bt);
+            if (res.HasCollision && res.ContactPoint.isNull()) {
+                res.ContactPoint = A->FindFurthestPoint(at, res.Normal);
+            }
+            return res;
+        });
+    }
+
+    inline CollisionPoints DetectCollision(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt);
+
+    // Anything against a compound (B is always the compound, it has the
+    // highest type). Only children under A's box are visited, each through
+    // the regular dispatch so nested compounds and any child type work.
+    inline CollisionPoints Test_Compound(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        using Compound = CompoundCollider;
+
+        Compound* B = (Compound*)b;
+
+        FrameVector<CollisionPoints> contacts;
+        B->QueryChildren(bt, a->GetAABB(at), [&](int i) {
+            Transform t = B->ChildTransform(bt, i);
+            CollisionPoints c = DetectCollision(a, at, B->m_children[i].Shape, &t);
+            if (c.HasCollision) {
+                contacts.push_back(c);
+            }
+        });
+        return ReduceContacts(contacts);
+    }
+
+    struct CollisionPair
+    {
+        Object* A;
+        Object* B;
+    };
+
+    using Detect_Collision_batch_func = void(*)(
+        const CollisionPair*, size_t,
+        FrameVector<Collision>&);
+
+    // Runs one type pair's kernel over a contiguous run of pairs; the test is
+    // a template argument so it is called directly instead of through the table.
+    template<Detect_Collision_func Test>
+    void Detect_Collision_Batch(
+        const CollisionPair* pairs, size_t count,
+        FrameVector<Collision>& collisions)
+    {
+        for (size_t i = 0; i < count; i++) {
+            Object* a = pairs[i].A;
+            Object* b = pairs[i].B;
+
+            CollisionPoints points = Test(
+                a->Collider, a->Transform,
+                b->Collider, b->Transform);
+
+            if (points.HasCollision) {
+                collisions.emplace_back(a, b, points);
+            }
+        }
+    }
+
+
+    // Sphere-sphere bucket. Centers and radii are gathered into SoA blocks so
+    // the rejection test is a straight loop the compiler can vectorize; only
+    // overlapping pairs reach Test_Sphere_Sphere.
+    inline void Detect_Sphere_Sphere_Batch(
+        const CollisionPair* pairs, size_t count,
+        FrameVector<Collision>& collisions)
+    {
+        using Sphere = SphereCollider;
+
+        const size_t block = 64;
+        float dx[block];
+        float dy[block];
+        float dz[block];
+        float rr[block];
+        int   hit[block];
+
+        for (size_t base = 0; base < count; base += block) {
+            size_t n = std::min(block, count - base);
+            const CollisionPair* run = pairs + base;
+
+            for (size_t i = 0; i < n; i++) {
+                const Sphere* A = (const Sphere*)run[i].A->Collider;
+                const Sphere* B = (const Sphere*)run[i].B->Collider;
+                QVector3D ab = (B->Center + run[i].B->Transform->Position)
+                             - (A->Center + run[i].A->Transform->Position);
+                dx[i] = ab.x();
+                dy[i] = ab.y();
+                dz[i] = ab.z();
+                rr[i] = A->Radius * major(run[i].A->Transform->Scale)
+                      + B->Radius * major(run[i].B->Transform->Scale);
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                hit[i] = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i] <= rr[i] * rr[i];
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                if (!hit[i]) continue;
+
+                Object* a = run[i].A;
+                Object* b = run[i].B;
+                collisions.emplace_back(a, b, Test_Sphere_Sphere(
+                    a->Collider, a->Transform,
+                    b->Collider, b->Transform));
+            }
+        }
+    }
+
 
     struct Detec_Collision_funcs
     {
-        Detect_Collision_func test[5][5] = {
-            {nullptr, Test_Plane_Sphere,  nullptr, Test_Plane_Hull, nullptr},
-            {nullptr, Test_Sphere_Sphere, nullptr, Test_GJK,        nullptr},
-            {nullptr, nullptr,            nullptr, Test_GJK,        nullptr},
-            {nullptr, nullptr,            nullptr, Test_GJK,        nullptr},
-            {nullptr, nullptr,            nullptr, nullptr,         nullptr},
-        };
+        using Hull        = HullCollider;
+        using Mesh        = MeshCollider;
+        using Heightfield = HeightfieldCollider;
+
+        static Detect_Collision_func Test(size_t atype, size_t btype)
+        {
+            static constexpr Detect_Collision_func test[ColliderTypeCount][ColliderTypeCount] = {
+                {nullptr, Test_Plane_Sphere,  Test_Plane_Capsule,   Test_Plane_Hull,      nullptr,                      nullptr,                             Test_Compound},
+                {nullptr, Test_Sphere_Sphere, Test_Sphere_Capsule,  Test_Sphere_Hull,     Test_Sphere_Triangles<Mesh>,  Test_Sphere_Triangles<Heightfield>,  Test_Compound},
+                {nullptr, nullptr,            Test_Capsule_Capsule, Test_Capsule_Hull,    Test_Capsule_Triangles<Mesh>, Test_Capsule_Triangles<Heightfield>, Test_Compound},
+                {nullptr, nullptr,            nullptr,              Test_GJK<Hull, Hull>, Test_Hull_Triangles<Mesh>,    Test_Hull_Triangles<Heightfield>,    Test_Compound},
+                {nullptr, nullptr,            nullptr,              nullptr,              nullptr,                      nullptr,                             Test_Compound},
+                {nullptr, nullptr,            nullptr,              nullptr,              nullptr,                      nullptr,                             Test_Compound},
+                {nullptr, nullptr,            nullptr,              nullptr,              nullptr,                      nullptr,                             Test_Compound},
+            };
+            return test[atype][btype];
+        }
+
+        static Detect_Collision_batch_func Batch(size_t atype, size_t btype)
+        {
+            static constexpr Detect_Collision_batch_func batch[ColliderTypeCount][ColliderTypeCount] = {
+                {nullptr, Detect_Collision_Batch<Test_Plane_Sphere>, Detect_Collision_Batch<Test_Plane_Capsule>,   Detect_Collision_Batch<Test_Plane_Hull>,      nullptr,                                              nullptr,                                                     Detect_Collision_Batch<Test_Compound>},
+                {nullptr, Detect_Sphere_Sphere_Batch,                Detect_Collision_Batch<Test_Sphere_Capsule>,  Detect_Collision_Batch<Test_Sphere_Hull>,     Detect_Collision_Batch<Test_Sphere_Triangles<Mesh>>,  Detect_Collision_Batch<Test_Sphere_Triangles<Heightfield>>,  Detect_Collision_Batch<Test_Compound>},
+                {nullptr, nullptr,                                   Detect_Collision_Batch<Test_Capsule_Capsule>, Detect_Collision_Batch<Test_Capsule_Hull>,    Detect_Collision_Batch<Test_Capsule_Triangles<Mesh>>, Detect_Collision_Batch<Test_Capsule_Triangles<Heightfield>>, Detect_Collision_Batch<Test_Compound>},
+                {nullptr, nullptr,                                   nullptr,                                      Detect_Collision_Batch<Test_GJK<Hull, Hull>>, Detect_Collision_Batch<Test_Hull_Triangles<Mesh>>,    Detect_Collision_Batch<Test_Hull_Triangles<Heightfield>>,    Detect_Collision_Batch<Test_Compound>},
+                {nullptr, nullptr,                                   nullptr,                                      nullptr,                                      nullptr,                                              nullptr,                                                     Detect_Collision_Batch<Test_Compound>},
+                {nullptr, nullptr,                                   nullptr,                                      nullptr,                                      nullptr,                                              nullptr,                                                     Detect_Collision_Batch<Test_Compound>},
+                {nullptr, nullptr,                                   nullptr,                                      nullptr,                                      nullptr,                                              nullptr,                                                     Detect_Collision_Batch<Test_Compound>},
+            };
+            return batch[atype][btype];
+        }
     };
 
 
 
 
-    CollisionPoints DetectCollision(
+    inline CollisionPoints DetectCollision(
         Collider*a, Transform *at,
         Collider*b, Transform *bt)
     {
@@ -173,8 +695,7 @@ namespace impl {
 
         CollisionPoints res;
 
-        Detec_Collision_funcs DCF;
-        auto& func = DCF.test[atype][btype];
+        Detect_Collision_func func = Detec_Collision_funcs::Test(atype, btype);
 
         if (func) {
             res = func(a, at, b, bt);
@@ -188,6 +709,77 @@ namespace impl {
         return res;
 
     }
+
+    // Boolean overlap for trigger pairs: no manifold and no EPA. Convex
+    // pairs stop as soon as GJK encloses the origin; everything else falls
+    // back to the contact test.
+    inline bool TestOverlap(
+        Collider* a, Transform* at,
+        Collider* b, Transform* bt)
+    {
+        auto convex = [](const Collider* c) {
+            return c->Type == ColliderType::SPHERE
+                || c->Type == ColliderType::CAPSULE
+                || c->Type == ColliderType::HULL;
+        };
+
+        if (a->Type == ColliderType::SPHERE && b->Type == ColliderType::SPHERE) {
+            const SphereCollider* A = (const SphereCollider*)a;
+            const SphereCollider* B = (const SphereCollider*)b;
+            float radius = A->Radius * major(at->Scale) + B->Radius * major(bt->Scale);
+            return ((B->Center + bt->Position) - (A->Center + at->Position)).lengthSquared() <= radius * radius;
+        }
+
+        if (convex(a) && convex(b)) {
+            return GJK(a, at, b, bt).first;
+        }
+
+        return DetectCollision(a, at, b, bt).HasCollision;
+    }
+
+    // Narrowphase over a whole pair list. Pairs are ordered so that A has the
+    // lower collider type, bucketed by type pair, and each bucket is handed to
+    // its specialized kernel in one go.
+    inline void DetectCollisions(
+        const FrameVector<CollisionPair>& pairs,
+        FrameVector<Collision>& collisions)
+    {
+        const size_t bucketCount = ColliderTypeCount * ColliderTypeCount;
+
+        size_t offsets[bucketCount + 1] = {};
+        for (const CollisionPair& pair : pairs) {
+            size_t atype = pair.A->Collider->get_type();
+            size_t btype = pair.B->Collider->get_type();
+            if (atype > btype) std::swap(atype, btype);
+            offsets[atype * ColliderTypeCount + btype + 1]++;
+        }
+        for (size_t i = 0; i < bucketCount; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        FrameVector<CollisionPair> sorted(pairs.size());
+        size_t cursor[bucketCount];
+        std::copy(offsets, offsets + bucketCount, cursor);
+        for (const CollisionPair& pair : pairs) {
+            CollisionPair p = pair;
+            if (p.A->Collider->get_type() > p.B->Collider->get_type()) {
+                std::swap(p.A, p.B);
+            }
+            size_t key = p.A->Collider->get_type() * ColliderTypeCount + p.B->Collider->get_type();
+            sorted[cursor[key]++] = p;
+        }
+
+        for (size_t atype = 0; atype < ColliderTypeCount; atype++) {
+            for (size_t btype = atype; btype < ColliderTypeCount; btype++) {
+                size_t key = atype * ColliderTypeCount + btype;
+                size_t count = offsets[key + 1] - offsets[key];
+                Detect_Collision_batch_func batch = Detec_Collision_funcs::Batch(atype, btype);
+                if (count && batch) {
+                    batch(sorted.data() + offsets[key], count, collisions);
+                }
+            }
+        }
+    }
 }
 
 }
@@ -4,55 +4,6 @@ namespace physE {
 
 namespace impl {
 
-    std::pair<bool, Simplex> GJK(
-            Collider* colliderA, Transform* transformA,
-            Collider* colliderB, Transform* transformB)
-    {
-        SupportPoint support = Support(
-                    colliderA, transformA,
-                    colliderB, transformB, QVector3D(1,0.1,0).normalized());
-
-        Simplex vertices;
-        vertices.push_front(support);
-
-        QVector3D direction = -support.C;
-
-        size_t iterations = 0;
-        while(iterations++ < 32u)
-        {
-            support = Support(
-                colliderA, transformA,
-                colliderB, transformB, direction);
-
-            // 下一个 support points 是否 “穿过” 原点
-            if (QVector3D::dotProduct(support.C, direction) <= 0) {
-                break;
-            }
-
-            vertices.push_front(support);
-
-
-            if (NextSimplex(vertices, direction)) {
-                return std::make_pair(true, vertices);
-            }
-
-        }
-
-        return {false, vertices};
-    }
-
-    SupportPoint Support(
-            Collider* colliderA, Transform* transformA,
-            Collider* colliderB, Transform* transformB,
-            QVector3D direction)
-    {
-        SupportPoint P;
-        P.A = colliderA->FindFurthestPoint(transformA, direction);
-        P.B = colliderB->FindFurthestPoint(transformB, -direction);
-        P.C = P.A - P.B;
-        return P;
-    }
-
     bool SameDirection(
             const QVector3D& direction,
             const QVector3D& ao)
@@ -169,12 +120,162 @@ namespace impl {
     }
 
 
+    // Closest point of triangle abc to the origin (Ericson, RTCD 5.1.5).
+    static QVector3D TriangleClosest(
+            const QVector3D& a, const QVector3D& b, const QVector3D& c,
+            float bary[3])
+    {
+        QVector3D ab = b - a;
+        QVector3D ac = c - a;
+
+        float d1 = QVector3D::dotProduct(ab, -a);
+        float d2 = QVector3D::dotProduct(ac, -a);
+        if (d1 <= 0 && d2 <= 0) {
+            bary[0] = 1; bary[1] = 0; bary[2] = 0;
+            return a;
+        }
+
+        float d3 = QVector3D::dotProduct(ab, -b);
+        float d4 = QVector3D::dotProduct(ac, -b);
+        if (d3 >= 0 && d4 <= d3) {
+            bary[0] = 0; bary[1] = 1; bary[2] = 0;
+            return b;
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+            float v = d1 / (d1 - d3);
+            bary[0] = 1 - v; bary[1] = v; bary[2] = 0;
+            return a + v * ab;
+        }
+
+        float d5 = QVector3D::dotProduct(ab, -c);
+        float d6 = QVector3D::dotProduct(ac, -c);
+        if (d6 >= 0 && d5 <= d6) {
+            bary[0] = 0; bary[1] = 0; bary[2] = 1;
+            return c;
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+            float w = d2 / (d2 - d6);
+            bary[0] = 1 - w; bary[1] = 0; bary[2] = w;
+            return a + w * ac;
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+            float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            bary[0] = 0; bary[1] = 1 - w; bary[2] = w;
+            return b + w * (c - b);
+        }
+
+        float denom = 1.0f / (va + vb + vc);
+        float v = vb * denom;
+        float w = vc * denom;
+        bary[0] = 1 - v - w; bary[1] = v; bary[2] = w;
+        return a + ab * v + ac * w;
+    }
+
+    QVector3D ClosestPointOnTriangle(
+            const QVector3D& p,
+            const QVector3D& a, const QVector3D& b, const QVector3D& c)
+    {
+        float bary[3];
+        return TriangleClosest(a - p, b - p, c - p, bary) + p;
+    }
+
+    bool ClosestToOrigin(Simplex& vertices, float lambda[4])
+    {
+        float bary[4] = {0, 0, 0, 0};
+
+        switch (vertices.size()) {
+        case 1:
+            bary[0] = 1;
+            break;
+        case 2:
+        {
+            QVector3D a = vertices[0].C;
+            QVector3D ab = vertices[1].C - a;
+            float denom = ab.lengthSquared();
+            float t = denom > 0 ? -QVector3D::dotProduct(a, ab) / denom : 0;
+            t = std::min(std::max(t, 0.0f), 1.0f);
+            bary[0] = 1 - t;
+            bary[1] = t;
+            break;
+        }
+        case 3:
+            TriangleClosest(vertices[0].C, vertices[1].C, vertices[2].C, bary);
+            break;
+        case 4:
+        {
+            static const int faces[4][4] = {
+                {0, 1, 2, 3},
+                {0, 2, 3, 1},
+                {0, 3, 1, 2},
+                {1, 3, 2, 0}
+            };
+
+            bool outside = false;
+            float best = FLT_MAX;
+            for (const auto& f : faces) {
+                QVector3D a = vertices[f[0]].C;
+                QVector3D b = vertices[f[1]].C;
+                QVector3D c = vertices[f[2]].C;
+                QVector3D d = vertices[f[3]].C;
+
+                QVector3D n = QVector3D::crossProduct(b - a, c - a);
+                float signO = QVector3D::dotProduct(-a, n);
+                float signD = QVector3D::dotProduct(d - a, n);
+                // a flat tetrahedron (coplanar hull faces) contains nothing,
+                // every face is a candidate then
+                bool flat = std::abs(signD) <= 1e-5f * n.length() * (d - a).length();
+                if (!flat && signO * signD >= 0) {
+                    continue;
+                }
+
+                outside = true;
+                float fb[3];
+                float dist = TriangleClosest(a, b, c, fb).lengthSquared();
+                if (dist < best) {
+                    best = dist;
+                    bary[0] = bary[1] = bary[2] = bary[3] = 0;
+                    bary[f[0]] = fb[0];
+                    bary[f[1]] = fb[1];
+                    bary[f[2]] = fb[2];
+                }
+            }
+
+            if (!outside) {
+                return false;
+            }
+            break;
+        }
+        }
+
+        // drop the vertices that do not support the closest point
+        size_t n = 0;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (bary[i] > 0) {
+                vertices[n] = vertices[i];
+                lambda[n] = bary[i];
+                n++;
+            }
+        }
+        if (n == 0) {
+            lambda[0] = 1;
+            n = 1;
+        }
+        vertices.m_size = n;
+        return true;
+    }
+
     // 计算每个平面的法线以及到原点距离， 以及最小距离平面的索引
-    std::pair<std::vector<QVector4D>, size_t> GetFaceNormals(
-            const std::vector<SupportPoint>&   polytope,
-            const std::vector<size_t>&      faces)
+    size_t GetFaceNormals(
+            const FrameVector<SupportPoint>&   polytope,
+            const FrameVector<size_t>&      faces,
+            FrameVector<QVector4D>&         normals)
     {
-        std::vector<QVector4D> normals;
         size_t minTriangle = 0;
         float minDistance = FLT_MAX;
 
@@ -204,12 +305,12 @@ namespace impl {
         //qDebug()<<normals[minTriangle];
         //qDebug()<<polytope[faces[3*minTriangle]]<<", "<<polytope[faces[3*minTriangle+1]]<<", "<<polytope[faces[3*minTriangle+2]];
 
-        return { normals, minTriangle };
+        return minTriangle;
     }
 
     void AddIfUniqueEdge(
-            std::vector<std::pair<size_t, size_t>>& edges,
-            const std::vector<size_t>& faces,
+            FrameVector<std::pair<size_t, size_t>>& edges,
+            const FrameVector<size_t>& faces,
             size_t a,
             size_t b)
     {
@@ -229,128 +330,17 @@ namespace impl {
     }
 
 
-    CollisionPoints EPA(
-            const Simplex & simplex,
-            Collider* colliderA, Transform* transformA,
-            Collider* colliderB, Transform* transformB)
+    QVector3D ContactFromPolytope(
+            const QVector3D& minNormal, float minDistance,
+            const SupportPoint& Ca, const SupportPoint& Cb, const SupportPoint& Cc,
+            bool* valid)
     {
-        std::vector<SupportPoint> polytope(simplex.begin(), simplex.end());
-        std::vector<size_t> faces = {
-            0,  1,  2,
-            0,  3,  1,
-            0,  2,  3,
-            1,  3,  2
-        };
-
-        auto P = GetFaceNormals(polytope, faces);
-        std::vector<QVector4D>  normals = std::get<0>(P);
-        size_t                  minFace = std::get<1>(P);
-
-        QVector3D minNormal;
-        float minDistance = FLT_MAX;
-
-        size_t iterations = 0;
-        while (minDistance == FLT_MAX)
-        {
-            minNormal   = normals[minFace].toVector3D();
-            minDistance = normals[minFace].w();
-
-            if(iterations++ > 32) break;
-
-            SupportPoint support = Support(colliderA, transformA, colliderB, transformB, minNormal);
-            float sDistance = QVector3D::dotProduct(minNormal, support.C);
-
-            if(std::abs(sDistance - minDistance) > 0.001f)
-            {
-                minDistance = FLT_MAX;
-
-                std::vector<std::pair<size_t, size_t>> uniqueEdges;
-
-                for(size_t i = 0; i < normals.size(); i++)
-                {
-                    // 判断下一个支撑点 “穿过” 原点
-                    if(SameDirection(normals[i].toVector3D(), support.C))
-                    {
-                        size_t f = i * 3;
-
-                        AddIfUniqueEdge(uniqueEdges, faces, f,     f + 1);
-                        AddIfUniqueEdge(uniqueEdges, faces, f + 1, f + 2);
-                        AddIfUniqueEdge(uniqueEdges, faces, f + 2, f    );
-
-                        //将 face 以及 normals 尾部数据交换到已经处理的位置 然后删除队尾
-                        faces[f + 2] = faces.back(); faces.pop_back();
-                        faces[f + 1] = faces.back(); faces.pop_back();
-                        faces[f    ] = faces.back(); faces.pop_back();
-
-                        normals[i] = normals.back(); normals.pop_back();
-
-                        i--;
-                    }
-                }
-
-                if (uniqueEdges.size() == 0) {
-                    break;
-                }
-
-                // 现在我们有了一个 unique edge 的列表，我们可
-                // 以将 newface 添加到一个列表中，并将支撑点添加
-                // 到多面体中。将 newface 存储在他们自己的列表中
-                // 允许我们仅计算这些 newface 的法线。
-                std::vector<size_t> newFaces;
-                for (int i = 0; i < uniqueEdges.size(); i++) {
-                    size_t edge1 = std::get<0>(uniqueEdges[i]);
-                    size_t edge2 = std::get<1>(uniqueEdges[i]);
-
-                    newFaces.push_back(edge1);
-                    newFaces.push_back(edge2);
-                    // 即 support 的索引
-                    newFaces.push_back(polytope.size());
-                }
-
-                polytope.push_back(support);
-
-                auto newNormalsFaces = GetFaceNormals(polytope, newFaces);
-                std::vector<QVector4D> newNormals = std::get<0>(newNormalsFaces);
-                size_t newMinFace = std::get<1>(newNormalsFaces);
-
-                float oldMinDistance = FLT_MAX;
-
-                for (size_t i = 0; i < normals.size(); i++) {
-                    if (normals[i].w() < oldMinDistance) {
-                        oldMinDistance = normals[i].w();
-                        minFace = i;
-                    }
-                }
-
-                if (newNormals[newMinFace].w() < oldMinDistance) {
-                    minFace = newMinFace + normals.size();
-                }
-
-                faces  .insert(faces  .end(), newFaces  .begin(), newFaces  .end());
-                normals.insert(normals.end(), newNormals.begin(), newNormals.end());
-
-            }
-        }
-        if (minDistance == FLT_MAX) {
-            return {};
-        }
-
-        CollisionPoints points;
-
         /* 求解 Contact Point
          * 1、求解 origin 在 EPA 最终得到的三角形上的投影点在该三角形上的重心坐标
          *  即解关于 x,y,z 的方程 Cp = x Ca + y Cb + z Cc
          *
          */
-        //qDebug()<<"#########################";
-        //qDebug()<<normals[minFace];
-        //qDebug()<<polytope[faces[3*minFace]].C<<","<<polytope[faces[3*minFace + 1]].C<<","<<polytope[faces[3*minFace + 2]].C;
-        //qDebug()<<"#########################";
-
         QVector3D Cp = minNormal * minDistance;
-        SupportPoint Ca = polytope[faces[3*minFace]];
-        SupportPoint Cb = polytope[faces[3*minFace + 1]];
-        SupportPoint Cc = polytope[faces[3*minFace + 2]];
 
         Eigen::MatrixXd A = Eigen::MatrixXd::Zero(3,3);
         Eigen::MatrixXd B = Eigen::MatrixXd::Zero(3,1);
@@ -374,17 +364,11 @@ namespace impl {
         QVector3D Bp = alpha * Ca.B + belta * Cb.B + gamma * Cc.B;
         //qDebug()<< Ap << ", " << Bp;
 
-        points.Normal = minNormal;
-        points.Depth = minDistance + 0.001f;
-        points.HasCollision = true;
-        if(abs(alpha + belta + gamma) > 1.5)
-        {
-            qDebug()<< alpha << ", " << belta <<", " << gamma;
-        }
-        else
-            points.ContactPoint = Ap;
+        // degenerate faces give wild barycentrics, the caller drops the
+        // contact point then
+        *valid = abs(alpha + belta + gamma) <= 1.5;
 
-        return points;
+        return Ap;
     }
 }
 
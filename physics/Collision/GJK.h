@@ -86,27 +86,276 @@ struct Simplex;
         auto end()   const { return Vertices.end() - (4u - m_size); }
     };
 
-    SupportPoint Support(
-            Collider* colliderA, Transform* transformA,
-            Collider* colliderB, Transform* transformB,
-            QVector3D direction);
+    bool SameDirection(
+            const QVector3D& direction,
+            const QVector3D& ao);
 
     bool NextSimplex(Simplex &vertices, QVector3D &direction);
 
+    // Appends the normals of faces to normals and returns the index of the
+    // closest one among them
+    size_t GetFaceNormals(
+            const FrameVector<SupportPoint>&   polytope,
+            const FrameVector<size_t>&      faces,
+            FrameVector<QVector4D>&         normals);
+
+    void AddIfUniqueEdge(
+            FrameVector<std::pair<size_t, size_t>>& edges,
+            const FrameVector<size_t>& faces,
+            size_t a,
+            size_t b);
+
+    QVector3D ClosestPointOnTriangle(
+            const QVector3D& p,
+            const QVector3D& a, const QVector3D& b, const QVector3D& c);
+
+    // Reduces the simplex to the sub-simplex whose closest point to the
+    // origin lies in its interior and writes the barycentric weights of the
+    // remaining vertices. Returns false when a tetrahedron contains the origin.
+    bool ClosestToOrigin(Simplex& vertices, float lambda[4]);
+
+    QVector3D ContactFromPolytope(
+            const QVector3D& minNormal, float minDistance,
+            const SupportPoint& Ca, const SupportPoint& Cb, const SupportPoint& Cc,
+            bool* valid);
+
+    // GJK / EPA are instantiated on the static collider types. The concrete
+    // colliders are final, so FindFurthestPoint binds statically and can be
+    // inlined; instantiating with Collider keeps the virtual call path.
+    template<typename ColliderA, typename ColliderB>
+    inline SupportPoint Support(
+            const ColliderA* colliderA, Transform* transformA,
+            const ColliderB* colliderB, Transform* transformB,
+            QVector3D direction)
+    {
+        SupportPoint P;
+        P.A = colliderA->FindFurthestPoint(transformA, direction);
+        P.B = colliderB->FindFurthestPoint(transformB, -direction);
+        P.C = P.A - P.B;
+        return P;
+    }
+
+    template<typename ColliderA, typename ColliderB>
+    std::pair<bool, Simplex> GJK(
+            const ColliderA* colliderA, Transform* transformA,
+            const ColliderB* colliderB, Transform* transformB)
+    {
+        SupportPoint support = Support(
+                    colliderA, transformA,
+                    colliderB, transformB, QVector3D(1,0.1,0).normalized());
+
+        Simplex vertices;
+        vertices.push_front(support);
 
+        QVector3D direction = -support.C;
+
+        size_t iterations = 0;
+        while(iterations++ < 32u)
+        {
+            support = Support(
+                colliderA, transformA,
+                colliderB, transformB, direction);
+
+            // 下一个 support points 是否 “穿过” 原点
+            if (QVector3D::dotProduct(support.C, direction) <= 0) {
+                break;
+            }
+
+            vertices.push_front(support);
+
+
+            if (NextSimplex(vertices, direction)) {
+                return std::make_pair(true, vertices);
+            }
+
+        }
+
+        return {false, vertices};
+    }
+
+    // GJK distance query. Returns false if the shapes overlap; otherwise
+    // pointA / pointB are the closest points and distance their separation.
+    template<typename ColliderA, typename ColliderB>
+    bool GJKDistance(
+            const ColliderA* colliderA, Transform* transformA,
+            const ColliderB* colliderB, Transform* transformB,
+            QVector3D& pointA, QVector3D& pointB, float& distance)
+    {
+        const float tolerance = 1e-4f;
+
+        Simplex vertices;
+        vertices.push_front(Support(
+                    colliderA, transformA,
+                    colliderB, transformB, QVector3D(1,0.1,0).normalized()));
+
+        float lambda[4] = {1, 0, 0, 0};
+        QVector3D v = vertices[0].C;
+
+        size_t iterations = 0;
+        while(iterations++ < 32u)
+        {
+            float vv = v.lengthSquared();
+            if (vv < tolerance * tolerance) {
+                return false;
+            }
+
+            SupportPoint w = Support(
+                colliderA, transformA,
+                colliderB, transformB, -v);
+
+            // no support point gets closer to the origin than v
+            if (vv - QVector3D::dotProduct(v, w.C) <= tolerance * std::sqrt(vv)) {
+                break;
+            }
+
+            vertices.push_front(w);
+            if (!ClosestToOrigin(vertices, lambda)) {
+                return false;
+            }
+
+            v = QVector3D();
+            for (size_t i = 0; i < vertices.size(); i++) {
+                v += lambda[i] * vertices[i].C;
+            }
+        }
+
+        pointA = QVector3D();
+        pointB = QVector3D();
+        for (size_t i = 0; i < vertices.size(); i++) {
+            pointA += lambda[i] * vertices[i].A;
+            pointB += lambda[i] * vertices[i].B;
+        }
+        distance = v.length();
+        return true;
+    }
+
+    template<typename ColliderA, typename ColliderB>
     CollisionPoints EPA(
             const Simplex & simplex,
-            Collider* colliderA, Transform* transformA,
-            Collider* colliderB, Transform* transformB);
+            const ColliderA* colliderA, Transform* transformA,
+            const ColliderB* colliderB, Transform* transformB)
+    {
+        // all scratch lives in the frame arena and is reused per iteration
+        FrameVector<SupportPoint> polytope(simplex.begin(), simplex.end());
+        FrameVector<size_t> faces = {
+            0,  1,  2,
+            0,  3,  1,
+            0,  2,  3,
+            1,  3,  2
+        };
+        FrameVector<QVector4D> normals;
+        FrameVector<std::pair<size_t, size_t>> uniqueEdges;
+        FrameVector<size_t> newFaces;
+        FrameVector<QVector4D> newNormals;
+
+        size_t minFace = GetFaceNormals(polytope, faces, normals);
+
+        QVector3D minNormal;
+        float minDistance = FLT_MAX;
+
+        size_t iterations = 0;
+        while (minDistance == FLT_MAX)
+        {
+            minNormal   = normals[minFace].toVector3D();
+            minDistance = normals[minFace].w();
 
+            if(iterations++ > 32) break;
 
-    std::pair<bool, Simplex> GJK(
-            Collider* colliderA, Transform* transformA,
-            Collider* colliderB, Transform* transformB);
+            SupportPoint support = Support(colliderA, transformA, colliderB, transformB, minNormal);
+            float sDistance = QVector3D::dotProduct(minNormal, support.C);
 
-    bool SameDirection(
-            const QVector3D& direction,
-            const QVector3D& ao);
+            if(std::abs(sDistance - minDistance) > 0.001f)
+            {
+                minDistance = FLT_MAX;
+
+                uniqueEdges.clear();
+
+                for(size_t i = 0; i < normals.size(); i++)
+                {
+                    // 判断下一个支撑点 “穿过” 原点
+                    if(SameDirection(normals[i].toVector3D(), support.C))
+                    {
+                        size_t f = i * 3;
+
+                        AddIfUniqueEdge(uniqueEdges, faces, f,     f + 1);
+                        AddIfUniqueEdge(uniqueEdges, faces, f + 1, f + 2);
+                        AddIfUniqueEdge(uniqueEdges, faces, f + 2, f    );
+
+                        //将 face 以及 normals 尾部数据交换到已经处理的位置 然后删除队尾
+                        faces[f + 2] = faces.back(); faces.pop_back();
+                        faces[f + 1] = faces.back(); faces.pop_back();
+                        faces[f    ] = faces.back(); faces.pop_back();
+
+                        normals[i] = normals.back(); normals.pop_back();
+
+                        i--;
+                    }
+                }
+
+                if (uniqueEdges.size() == 0) {
+                    break;
+                }
+
+                // 现在我们有了一个 unique edge 的列表，我们可
+                // 以将 newface 添加到一个列表中，并将支撑点添加
+                // 到多面体中。将 newface 存储在他们自己的列表中
+                // 允许我们仅计算这些 newface 的法线。
+                newFaces.clear();
+                for (size_t i = 0; i < uniqueEdges.size(); i++) {
+                    size_t edge1 = std::get<0>(uniqueEdges[i]);
+                    size_t edge2 = std::get<1>(uniqueEdges[i]);
+
+                    newFaces.push_back(edge1);
+                    newFaces.push_back(edge2);
+                    // 即 support 的索引
+                    newFaces.push_back(polytope.size());
+                }
+
+                polytope.push_back(support);
+
+                newNormals.clear();
+                size_t newMinFace = GetFaceNormals(polytope, newFaces, newNormals);
+
+                float oldMinDistance = FLT_MAX;
+
+                for (size_t i = 0; i < normals.size(); i++) {
+                    if (normals[i].w() < oldMinDistance) {
+                        oldMinDistance = normals[i].w();
+                        minFace = i;
+                    }
+                }
+
+                if (newNormals[newMinFace].w() < oldMinDistance) {
+                    minFace = newMinFace + normals.size();
+                }
+
+                faces  .insert(faces  .end(), newFaces  .begin(), newFaces  .end());
+                normals.insert(normals.end(), newNormals.begin(), newNormals.end());
+
+            }
+        }
+        if (minDistance == FLT_MAX) {
+            return {};
+        }
+
+        CollisionPoints points;
+
+        bool valid = false;
+        QVector3D contact = ContactFromPolytope(
+                    minNormal, minDistance,
+                    polytope[faces[3*minFace]],
+                    polytope[faces[3*minFace + 1]],
+                    polytope[faces[3*minFace + 2]],
+                    &valid);
+
+        points.Normal = minNormal;
+        points.Depth = minDistance + 0.001f;
+        points.HasCollision = true;
+        if(valid)
+            points.ContactPoint = contact;
+
+        return points;
+    }
 
 
 
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "Collider.h"
+#include <cfloat>
+#include <cmath>
+
+namespace physE {
+namespace impl {
+
+    // Regular grid of heights over the local xz plane, for terrain. Sample
+    // (i, j) sits at (i * CellSize, height, j * CellSize). Heights are either
+    // plain floats or quantized to 16 bits as HeightOffset + q * HeightScale,
+    // which is precise enough for terrain and halves the memory.
+    struct HeightfieldCollider final
+        : Collider
+    {
+    public:
+        int Columns;    // samples along x
+        int Rows;       // samples along z
+        float CellSize;
+        float HeightScale;
+        float HeightOffset;
+        float MinHeight;
+        float MaxHeight;
+
+        std::vector<float> m_heights;
+        std::vector<quint16> m_quantized;
+
+        std::vector<VerNorm> m_data;
+        std::vector<int> m_index;
+
+        QOpenGLVertexArrayObject VAO;
+        QOpenGLBuffer VBO;
+
+        HeightfieldCollider()
+            : Collider(ColliderType::HEIGHTFIELD)
+            , Columns(0)
+            , Rows(0)
+            , CellSize(1.0f)
+            , HeightScale(1.0f)
+            , HeightOffset(0.0f)
+            , MinHeight(0.0f)
+            , MaxHeight(0.0f)
+        {
+
+        }
+
+        // heights is row major, columns * rows samples
+        void setHeights(int columns, int rows, float cellSize, std::vector<float> heights, bool quantize = false)
+        {
+            assert(columns >= 2 && rows >= 2);
+            assert(heights.size() == size_t(columns) * rows);
+
+            Columns = columns;
+            Rows = rows;
+            CellSize = cellSize;
+            MinHeight = *std::min_element(heights.begin(), heights.end());
+            MaxHeight = *std::max_element(heights.begin(), heights.end());
+
+            m_heights.clear();
+            m_quantized.clear();
+            if (quantize) {
+                HeightOffset = MinHeight;
+                HeightScale = MaxHeight > MinHeight ? (MaxHeight - MinHeight) / 65535.0f : 1.0f;
+                m_quantized.resize(heights.size());
+                for (size_t i = 0; i < heights.size(); i++) {
+                    m_quantized[i] = quint16(std::lround((heights[i] - HeightOffset) / HeightScale));
+                }
+            }
+            else {
+                m_heights = std::move(heights);
+            }
+            m_data.clear();
+        }
+
+        float Height(int i, int j) const
+        {
+            int s = j * Columns + i;
+            return m_quantized.empty() ? m_heights[s] : HeightOffset + m_quantized[s] * HeightScale;
+        }
+
+        QVector3D Sample(int i, int j) const
+        {
+            return QVector3D(i * CellSize, Height(i, j), j * CellSize);
+        }
+
+        // Calls visit(v) with the world space corners of both triangles of
+        // every cell under box. Cells are culled in the local frame against
+        // the box's footprint first and then against their own height range.
+        template<typename F>
+        void ForEachTriangle(Transform* transform, const AABB& box, F&& visit) const
+        {
+            if (Columns < 2 || Rows < 2) return;
+
+            AABB local = ToLocal(transform, box);
+            if (local.Min.y() > MaxHeight || local.Max.y() < MinHeight) return;
+
+            int i0 = std::max(0,           int(std::floor(local.Min.x() / CellSize)));
+            int i1 = std::min(Columns - 2, int(std::floor(local.Max.x() / CellSize)));
+            int j0 = std::max(0,           int(std::floor(local.Min.z() / CellSize)));
+            int j1 = std::min(Rows - 2,    int(std::floor(local.Max.z() / CellSize)));
+
+            for (int j = j0; j <= j1; j++) {
+                for (int i = i0; i <= i1; i++) {
+                    float h00 = Height(i, j),     h10 = Height(i + 1, j);
+                    float h01 = Height(i, j + 1), h11 = Height(i + 1, j + 1);
+                    float lo = std::min(std::min(h00, h10), std::min(h01, h11));
+                    float hi = std::max(std::max(h00, h10), std::max(h01, h11));
+                    if (local.Min.y() > hi || local.Max.y() < lo) continue;
+
+                    QVector3D t0[3], t1[3];
+                    CellTriangles(transform, i, j, t0, t1);
+                    visit(t0);
+                    visit(t1);
+                }
+            }
+        }
+
+        // Calls visit(v, maxT) with the world space corners of both
+        // triangles of every cell the segment origin + t * direction,
+        // 0 <= t <= maxT, crosses, walking the cells front to back with a
+        // 2D DDA over the local xz plane. visit may lower maxT to stop the
+        // walk behind a hit.
+        template<typename F>
+        void Raycast(Transform* transform, const QVector3D& origin, const QVector3D& direction, float maxT,
+                     F&& visit) const
+        {
+            if (Columns < 2 || Rows < 2) return;
+
+            const QMatrix4x4 inv = transform->Rotation.transposed();
+            const QVector3D o = inv.mapVector(origin - transform->Position);
+            const QVector3D d = inv.mapVector(direction);
+
+            // clip to the box of the field
+            const QVector3D lo(0, MinHeight, 0);
+            const QVector3D hi((Columns - 1) * CellSize, MaxHeight, (Rows - 1) * CellSize);
+            float tEnter = 0;
+            float tExit = maxT;
+            for (int k = 0; k < 3; k++) {
+                if (d[k] == 0) {
+                    if (o[k] < lo[k] || o[k] > hi[k]) return;
+                    continue;
+                }
+                float t0 = (lo[k] - o[k]) / d[k];
+                float t1 = (hi[k] - o[k]) / d[k];
+                if (t0 > t1) std::swap(t0, t1);
+                tEnter = std::max(tEnter, t0);
+                tExit = std::min(tExit, t1);
+                if (tEnter > tExit) return;
+            }
+
+            const QVector3D p = o + tEnter * d;
+            int i = std::min(std::max(int(std::floor(p.x() / CellSize)), 0), Columns - 2);
+            int j = std::min(std::max(int(std::floor(p.z() / CellSize)), 0), Rows - 2);
+            const int stepI = d.x() > 0 ? 1 : -1;
+            const int stepJ = d.z() > 0 ? 1 : -1;
+            const float deltaI = d.x() != 0 ? CellSize / std::abs(d.x()) : FLT_MAX;
+            const float deltaJ = d.z() != 0 ? CellSize / std::abs(d.z()) : FLT_MAX;
+            // where the ray leaves the current cell across x and across z
+            float nextI = d.x() != 0 ? ((i + (stepI > 0)) * CellSize - o.x()) / d.x() : FLT_MAX;
+            float nextJ = d.z() != 0 ? ((j + (stepJ > 0)) * CellSize - o.z()) / d.z() : FLT_MAX;
+
+            float enter = tEnter;
+            while (enter <= std::min(maxT, tExit)) {
+                const float leave = std::min(std::min(nextI, nextJ), tExit);
+
+                // skip cells the ray passes above or below
+                const float y0 = o.y() + enter * d.y();
+                const float y1 = o.y() + leave * d.y();
+                float h00 = Height(i, j),     h10 = Height(i + 1, j);
+                float h01 = Height(i, j + 1), h11 = Height(i + 1, j + 1);
+                float cellLo = std::min(std::min(h00, h10), std::min(h01, h11));
+                float cellHi = std::max(std::max(h00, h10), std::max(h01, h11));
+                if (std::max(y0, y1) >= cellLo && std::min(y0, y1) <= cellHi) {
+                    QVector3D t0[3], t1[3];
+                    CellTriangles(transform, i, j, t0, t1);
+                    visit(t0, maxT);
+                    visit(t1, maxT);
+                }
+
+                if (nextI < nextJ) {
+                    i += stepI;
+                    enter = nextI;
+                    nextI += deltaI;
+                    if (i < 0 || i > Columns - 2) break;
+                }
+                else {
+                    j += stepJ;
+                    enter = nextJ;
+                    nextJ += deltaJ;
+                    if (j < 0 || j > Rows - 2) break;
+                }
+            }
+        }
+
+        // World space corners of the two triangles of cell (i, j), wound so
+        // the face normals point up
+        void CellTriangles(Transform* transform, int i, int j, QVector3D t0[3], QVector3D t1[3]) const
+        {
+            QVector3D p00 = ToWorldPoint(transform, Sample(i,     j));
+            QVector3D p10 = ToWorldPoint(transform, Sample(i + 1, j));
+            QVector3D p01 = ToWorldPoint(transform, Sample(i,     j + 1));
+            QVector3D p11 = ToWorldPoint(transform, Sample(i + 1, j + 1));
+            t0[0] = p00; t0[1] = p01; t0[2] = p10;
+            t1[0] = p10; t1[1] = p01; t1[2] = p11;
+        }
+
+        static QVector3D ToWorldPoint(Transform* transform, const QVector3D& p)
+        {
+            return transform->Rotation.mapVector(p) + transform->Position;
+        }
+
+        QVector3D FindFurthestPoint(
+            Transform* transform,
+            const QVector3D& direction) const override
+        {
+            // a heightfield is not convex and has no support mapping
+            assert(false);
+            return QVector3D(0, 0, 0);
+        }
+
+        AABB GetAABB(Transform* transform) const override
+        {
+            return ToWorld(transform, AABB(
+                QVector3D(0, MinHeight, 0),
+                QVector3D((Columns - 1) * CellSize, MaxHeight, (Rows - 1) * CellSize)));
+        }
+
+        void BuildMesh()
+        {
+            m_data.clear();
+            m_index.clear();
+
+            for (int j = 0; j < Rows; j++) {
+                for (int i = 0; i < Columns; i++) {
+                    VerNorm vn(Sample(i, j));
+                    // central differences, clamped at the border
+                    float dx = Height(std::min(i + 1, Columns - 1), j) - Height(std::max(i - 1, 0), j);
+                    float dz = Height(i, std::min(j + 1, Rows - 1)) - Height(i, std::max(j - 1, 0));
+                    vn.Norm = QVector3D(-dx, 2 * CellSize, -dz).normalized();
+                    m_data.push_back(vn);
+                }
+            }
+
+            for (int j = 0; j + 1 < Rows; j++) {
+                for (int i = 0; i + 1 < Columns; i++) {
+                    int a = j * Columns + i;
+                    int b = a + Columns;
+                    m_index.insert(m_index.end(), {a, b, a + 1, a + 1, b, b + 1});
+                }
+            }
+        }
+
+        void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram, Transform* transform) override
+        {
+            QMatrix4x4 model;
+            model.translate(transform->Position);
+            model *= transform->Rotation;
+            shaderProgram->setUniformValue("model", model);
+            if(VAO.objectId() == 0)
+            {
+                if (m_data.empty()) {
+                    BuildMesh();
+                }
+
+                VAO.create();
+                VAO.bind();
+                VBO = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+                QOpenGLBuffer ebo(QOpenGLBuffer::IndexBuffer);
+                VBO.create();
+                ebo.create();
+                VBO.bind();
+                VBO.allocate(m_data.data(), m_data.size() * sizeof(VerNorm));
+                ebo.bind();
+                ebo.allocate(&m_index[0], m_index.size() * sizeof(unsigned int));
+
+                shaderProgram->enableAttributeArray(0);
+                shaderProgram->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(VerNorm));
+                shaderProgram->enableAttributeArray(1);
+                shaderProgram->setAttributeBuffer(1, GL_FLOAT, offsetof(VerNorm, Norm), 3, sizeof(VerNorm));
+                VAO.release();
+            }
+
+            QOpenGLVertexArrayObject::Binder bind(&VAO);
+            glFunc->glDrawElements(GL_TRIANGLES, m_index.size(), GL_UNSIGNED_INT, 0);
+        }
+    };
+
+}
+}
+using namespace physE;
@@ -1,16 +1,26 @@
 #pragma once
 
 #include "Collider.h"
+#include "../algo/quickhull.h"
 #include <new>
+#include <algorithm>
 
 namespace physE {
 namespace impl {
 
-    struct HullCollider : Collider
+    struct HullCollider final : Collider
     {
         std::vector<VerNorm> m_data;
         std::vector<int> m_index;
 
+        // filled by setPoints; setData leaves them empty
+        std::vector<HullFace> m_faces;
+        std::vector<int> m_faceVertices;
+
+        // vertex neighbours, m_adjacent[m_adjOffset[v], m_adjOffset[v + 1])
+        std::vector<int> m_adjOffset;
+        std::vector<int> m_adjacent;
+
         QOpenGLVertexArrayObject VAO;
         QOpenGLBuffer VBO;
 
@@ -24,7 +34,63 @@ namespace impl {
         {
             m_index = index;
             m_data.resize(vertices.size());
+            m_faces.clear();
+            m_faceVertices.clear();
             ComputeNormal(vertices);
+            BuildAdjacency();
+        }
+
+        // Builds the hull of an arbitrary point cloud. maxVertices > 0 keeps
+        // only that many vertices (an inner approximation), nearly coplanar
+        // triangles are merged into polygon faces.
+        bool setPoints(const std::vector<QVector3D>& points, int maxVertices = 0, float mergeAngle = 0.01f)
+        {
+            ConvexHullData hull;
+            if (!QuickHull(points, hull, maxVertices, mergeAngle)) {
+                return false;
+            }
+
+            m_index = std::move(hull.Index);
+            m_faces = std::move(hull.Faces);
+            m_faceVertices = std::move(hull.FaceVertices);
+
+            // vertex normals from the faces around them
+            m_data.assign(hull.Vertices.begin(), hull.Vertices.end());
+            for (const HullFace& face : m_faces) {
+                for (int k = 0; k < face.Count; k++) {
+                    m_data[m_faceVertices[face.First + k]].Norm += face.Normal;
+                }
+            }
+            for (VerNorm& v : m_data) {
+                v.Norm.normalize();
+            }
+
+            BuildAdjacency();
+            return true;
+        }
+
+        void BuildAdjacency()
+        {
+            const int n = m_data.size();
+            std::vector<std::vector<int>> neighbours(n);
+            auto link = [&](int a, int b) {
+                if (std::find(neighbours[a].begin(), neighbours[a].end(), b) == neighbours[a].end()) {
+                    neighbours[a].push_back(b);
+                    neighbours[b].push_back(a);
+                }
+            };
+            for (size_t t = 0; t + 2 < m_index.size(); t += 3) {
+                link(m_index[t    ], m_index[t + 1]);
+                link(m_index[t + 1], m_index[t + 2]);
+                link(m_index[t + 2], m_index[t    ]);
+            }
+
+            m_adjOffset.assign(1, 0);
+            m_adjacent.clear();
+            for (int v = 0; v < n; v++) {
+                m_adjacent.insert(m_adjacent.end(), neighbours[v].begin(), neighbours[v].end());
+                m_adjOffset.push_back(m_adjacent.size());
+            }
         }
 
         bool ComputeNormal(std::vector<QVector3D> vertices)
@@ -60,25 +126,43 @@ namespace impl {
             return true;
         }
 
+        // Small hulls are scanned; larger ones hill climb over the vertex
+        // adjacency, which on a convex hull always ends at the furthest vertex.
         QVector3D FindFurthestPoint(
                 Transform *transform,
                 const QVector3D &direction) const override
         {
-            QVector3D furthestPoint;
-
-            float maxDistance = INT_MIN;
-
-            for(auto& point : m_data)
-            {
-                float distance = QVector3D::dotProduct(transform->Rotation*point.Vertex, direction);
-                if(distance > maxDistance)
-                {
-                    maxDistance = distance;
-                    furthestPoint = point.Vertex;
+            // work in the hull's frame, rotation is orthonormal
+            QVector3D local = transform->Rotation.transposed().mapVector(direction);
+
+            int best = 0;
+            float maxDistance = -FLT_MAX;
+            if (m_data.size() <= 32 || m_adjOffset.size() != m_data.size() + 1) {
+                for (int i = 0; i < (int)m_data.size(); i++) {
+                    float distance = QVector3D::dotProduct(m_data[i].Vertex, local);
+                    if (distance > maxDistance) {
+                        maxDistance = distance;
+                        best = i;
+                    }
+                }
+            }
+            else {
+                maxDistance = QVector3D::dotProduct(m_data[0].Vertex, local);
+                for (bool moved = true; moved; ) {
+                    moved = false;
+                    for (int k = m_adjOffset[best]; k < m_adjOffset[best + 1]; k++) {
+                        int v = m_adjacent[k];
+                        float distance = QVector3D::dotProduct(m_data[v].Vertex, local);
+                        if (distance > maxDistance) {
+                            maxDistance = distance;
+                            best = v;
+                            moved = true;
+                        }
+                    }
                 }
             }
 
-            return transform->Rotation*furthestPoint + transform->Position;
+            return transform->Rotation.mapVector(m_data[best].Vertex) + transform->Position;
         }
 
         void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram, Transform* transform)  override
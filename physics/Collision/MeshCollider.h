@@ -0,0 +1,175 @@
+#pragma once
+
+#include "Collider.h"
+#include "../algo/bvh.h"
+
+namespace physE {
+namespace impl {
+
+    // Static triangle soup for level geometry. Triangles are kept in BVH leaf
+    // order so a query walks the index buffer mostly sequentially.
+    struct MeshCollider final
+        : Collider
+    {
+        std::vector<QVector3D> m_vertices;
+        std::vector<int> m_index;
+        BVH m_bvh;
+
+        std::vector<VerNorm> m_data;
+
+        QOpenGLVertexArrayObject VAO;
+        QOpenGLBuffer VBO;
+
+        MeshCollider()
+            : Collider(ColliderType::MESH)
+        {
+
+        }
+
+        void setData(std::vector<QVector3D> vertices, std::vector<int> index)
+        {
+            m_vertices = std::move(vertices);
+            m_index = std::move(index);
+            BuildBVH();
+        }
+
+        size_t TriangleCount() const
+        {
+            return m_index.size() / 3;
+        }
+
+        void BuildBVH()
+        {
+            std::vector<AABB> bounds(TriangleCount());
+            for (size_t t = 0; t < bounds.size(); t++) {
+                bounds[t].Expand(m_vertices[m_index[3 * t    ]]);
+                bounds[t].Expand(m_vertices[m_index[3 * t + 1]]);
+                bounds[t].Expand(m_vertices[m_index[3 * t + 2]]);
+            }
+            m_bvh.Build(bounds, 4);
+
+            // reorder the triangles to match the leaves
+            std::vector<int> ordered(m_index.size());
+            for (size_t i = 0; i < m_bvh.m_indices.size(); i++) {
+                int t = m_bvh.m_indices[i];
+                ordered[3 * i    ] = m_index[3 * t    ];
+                ordered[3 * i + 1] = m_index[3 * t + 1];
+                ordered[3 * i + 2] = m_index[3 * t + 2];
+                m_bvh.m_indices[i] = i;
+            }
+            m_index.swap(ordered);
+        }
+
+        // World space corners of triangle t
+        void Triangle(Transform* transform, int t, QVector3D v[3]) const
+        {
+            for (int i = 0; i < 3; i++) {
+                v[i] = transform->Rotation.mapVector(m_vertices[m_index[3 * t + i]]) + transform->Position;
+            }
+        }
+
+        // Calls visit(triangle) for the triangles whose leaf overlaps box
+        template<typename F>
+        void QueryTriangles(Transform* transform, const AABB& box, F&& visit) const
+        {
+            m_bvh.Query(ToLocal(transform, box), std::forward<F>(visit));
+        }
+
+        // Calls visit(v) with the world space corners of every candidate
+        // triangle under box
+        template<typename F>
+        void ForEachTriangle(Transform* transform, const AABB& box, F&& visit) const
+        {
+            QueryTriangles(transform, box, [&](int t) {
+                QVector3D v[3];
+                Triangle(transform, t, v);
+                visit(v);
+            });
+        }
+
+        // Calls visit(v, maxT) with the world space corners of the triangles
+        // in the leaves the segment origin + t * direction, 0 <= t <= maxT,
+        // passes through, nearer leaves first. visit may lower maxT to cut
+        // off everything behind a hit.
+        template<typename F>
+        void Raycast(Transform* transform, const QVector3D& origin, const QVector3D& direction, float maxT,
+                     F&& visit) const
+        {
+            const QMatrix4x4 inv = transform->Rotation.transposed();
+            m_bvh.Raycast(inv.mapVector(origin - transform->Position), inv.mapVector(direction), maxT,
+                [&](int t, float& limit) {
+                    QVector3D v[3];
+                    Triangle(transform, t, v);
+                    visit(v, limit);
+                });
+        }
+
+        QVector3D FindFurthestPoint(
+            Transform* transform,
+            const QVector3D& direction) const override
+        {
+            // a triangle soup has no support mapping
+            assert(false);
+            return QVector3D(0, 0, 0);
+        }
+
+        AABB GetAABB(Transform* transform) const override
+        {
+            return ToWorld(transform, m_bvh.Bounds());
+        }
+
+        void BuildRenderData()
+        {
+            m_data.assign(m_vertices.begin(), m_vertices.end());
+            for (size_t t = 0; t < TriangleCount(); t++) {
+                const QVector3D& A = m_vertices[m_index[3 * t    ]];
+                const QVector3D& B = m_vertices[m_index[3 * t + 1]];
+                const QVector3D& C = m_vertices[m_index[3 * t + 2]];
+                QVector3D N = QVector3D::crossProduct(B - A, C - A);
+                m_data[m_index[3 * t    ]].Norm += N;
+                m_data[m_index[3 * t + 1]].Norm += N;
+                m_data[m_index[3 * t + 2]].Norm += N;
+            }
+            for (VerNorm& v : m_data) {
+                v.Norm.normalize();
+            }
+        }
+
+        void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram, Transform* transform) override
+        {
+            QMatrix4x4 model;
+            model.translate(transform->Position);
+            model *= transform->Rotation;
+            shaderProgram->setUniformValue("model", model);
+            if(VAO.objectId() == 0)
+            {
+                if (m_data.empty()) {
+                    BuildRenderData();
+                }
+
+                VAO.create();
+                VAO.bind();
+                VBO = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+                QOpenGLBuffer ebo(QOpenGLBuffer::IndexBuffer);
+                VBO.create();
+                ebo.create();
+                VBO.bind();
+                VBO.allocate(m_data.data(), m_data.size() * sizeof(VerNorm));
+                ebo.bind();
+                ebo.allocate(&m_index[0], m_index.size() * sizeof(unsigned int));
+
+                shaderProgram->enableAttributeArray(0);
+                shaderProgram->setAttributeBuffer(0, GL_FLOAT, 0, 3, sizeof(VerNorm));
+                shaderProgram->enableAttributeArray(1);
+                shaderProgram->setAttributeBuffer(1, GL_FLOAT, offsetof(VerNorm, Norm), 3, sizeof(VerNorm));
+                VAO.release();
+            }
+
+            QOpenGLVertexArrayObject::Binder bind(&VAO);
+            glFunc->glDrawElements(GL_TRIANGLES, m_index.size(), GL_UNSIGNED_INT, 0);
+        }
+    };
+
+}
+}
+using namespace physE;
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include "CollisionObject.h"
+
+namespace physE {
+
+    // Stays valid while the object lives; once it is removed the slot's
+    // generation moves on and the old handle resolves to nullptr, even after
+    // the slot has been reused.
+    struct ObjectHandle {
+        quint32 Index = 0xFFFFFFFF;
+        quint32 Generation = 0;
+
+        bool operator == (const ObjectHandle& b) const {
+            return Index == b.Index && Generation == b.Generation;
+        }
+        bool operator != (const ObjectHandle& b) const {
+            return !(*this == b);
+        }
+    };
+
+    // Owns the objects of a world. Objects are constructed in place in
+    // fixed size chunks, so their addresses never change and no memory is
+    // returned to the system while the world runs; freed slots go on a free
+    // list and are reused first.
+    //
+    // Live objects are also kept in one dense array for iteration. Removing
+    // only invalidates the handle, the object stays in that array until
+    // Flush, so it is safe to remove objects while a step walks the array.
+    class ObjectPool
+    {
+    public:
+        ObjectPool() = default;
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator = (const ObjectPool&) = delete;
+
+        ~ObjectPool()
+        {
+            for (Object* obj : m_objects) {
+                obj->~Object();
+            }
+        }
+
+        template<typename... Args>
+        ObjectHandle Create(Args&&... args)
+        {
+            if (m_freeHead < 0) Grow();
+
+            const int index = m_freeHead;
+            Slot& slot = At(index);
+            m_freeHead = slot.NextFree;
+
+            Object* obj = new (&slot.Storage) Object(std::forward<Args>(args)...);
+            obj->idx = index;
+            slot.Dense = m_objects.size();
+            m_objects.push_back(obj);
+
+            return {quint32(index), slot.Generation};
+        }
+
+        // nullptr for stale or removed handles
+        Object* Get(ObjectHandle handle) const
+        {
+            if (handle.Index >= m_capacity) return nullptr;
+
+            const Slot& slot = At(handle.Index);
+            if (slot.Generation != handle.Generation || slot.Dense < 0) return nullptr;
+            return (Object*)&slot.Storage;
+        }
+
+        ObjectHandle Handle(const Object* obj) const
+        {
+            return {quint32(obj->idx), At(obj->idx).Generation};
+        }
+
+        // Invalidates the handle, the object is destroyed by the next Flush
+        bool Remove(ObjectHandle handle)
+        {
+            Object* obj = Get(handle);
+            if (!obj) return false;
+
+            At(handle.Index).Generation++;
+            m_pending.push_back(obj);
+            return true;
+        }
+
+        const std::vector<Object*>& Pending() const
+        {
+            return m_pending;
+        }
+
+        void Flush()
+        {
+            for (Object* obj : m_pending) {
+                const int index = obj->idx;
+                Slot& slot = At(index);
+
+                // swap the last live object into the hole
+                Object* last = m_objects.back();
+                m_objects[slot.Dense] = last;
+                At(last->idx).Dense = slot.Dense;
+                m_objects.pop_back();
+
+                obj->~Object();
+                slot.Dense = -1;
+                slot.NextFree = m_freeHead;
+                m_freeHead = index;
+            }
+            m_pending.clear();
+        }
+
+        const QVector<Object*>& Objects() const
+        {
+            return m_objects;
+        }
+
+        int Size() const
+        {
+            return m_objects.size();
+        }
+
+    private:
+        static const int ChunkSize = 256;
+
+        struct Slot {
+            typename std::aligned_storage<sizeof(Object), alignof(Object)>::type Storage;
+            quint32 Generation = 0;
+            int Dense = -1;     // position in m_objects, -1 while free
+            int NextFree = -1;
+        };
+
+        Slot& At(int index) const
+        {
+            return m_chunks[index / ChunkSize][index % ChunkSize];
+        }
+
+        void Grow()
+        {
+            const int first = m_capacity;
+            m_chunks.emplace_back(new Slot[ChunkSize]);
+            m_capacity += ChunkSize;
+
+            // hand out the new slots in ascending order
+            for (int i = ChunkSize - 1; i >= 0; i--) {
+                m_chunks.back()[i].NextFree = m_freeHead;
+                m_freeHead = first + i;
+            }
+        }
+
+        std::vector<std::unique_ptr<Slot[]>> m_chunks;
+        quint32 m_capacity = 0;
+        int m_freeHead = -1;
+
+        QVector<Object*> m_objects;
+        std::vector<Object*> m_pending;
+    };
+
+}
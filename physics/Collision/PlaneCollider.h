@@ -4,7 +4,7 @@
 
 namespace physE {
 namespace impl {
-    struct PlaneCollider
+    struct PlaneCollider final
         : Collider
     {
         QVector3D Normal;
@@ -48,6 +48,11 @@ namespace impl {
             return QVector3D(0, 0, 0);
         }
 
+        AABB GetAABB(Transform* /*transform*/) const override
+        {
+            return AABB::Infinite();
+        }
+
         void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram, Transform* transform) override
         {
             QMatrix4x4 model;
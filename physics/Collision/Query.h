@@ -0,0 +1,311 @@
+#pragma once
+
+#include "DetectCollisoin.h"
+
+namespace physE {
+
+    struct RaycastHit {
+        Object* Obj = nullptr;
+        QVector3D Point;        // on the surface that was hit
+        QVector3D Normal;       // of that surface, facing the caster
+        float Distance = 0;     // along the cast, 0 when it started inside
+    };
+
+    struct Ray {
+        QVector3D Origin;
+        QVector3D Direction;
+        float MaxDistance = FLT_MAX;
+    };
+
+    // Objects are only reported when their Category is in Mask
+    struct QueryFilter {
+        quint32 Mask = 0xFFFFFFFF;
+        bool HitTriggers = false;
+        const Object* Ignore = nullptr;
+
+        bool Accepts(const Object* obj) const {
+            return obj != Ignore && (obj->Category & Mask) && (HitTriggers || !obj->IsTrigger);
+        }
+    };
+
+namespace impl {
+
+    // Casters without a collider. Both are already in world space and
+    // ignore the transform.
+    struct PointShape
+    {
+        QVector3D P;
+
+        QVector3D FindFurthestPoint(Transform* /*transform*/, const QVector3D& /*direction*/) const
+        {
+            return P;
+        }
+    };
+
+    struct SphereShape
+    {
+        QVector3D Center;
+        float Radius;
+
+        QVector3D FindFurthestPoint(Transform* /*transform*/, const QVector3D& direction) const
+        {
+            return Center + Radius * direction.normalized();
+        }
+    };
+
+    // GJK raycast (van den Bergen): A moves along direction, B stays put.
+    // The ray origin + t * direction is clipped against the Minkowski
+    // difference B - A by conservative advancement, so any pair of support
+    // mapped shapes works. t is in units of direction, which must be
+    // normalized for the result to be a distance.
+    template<typename ColliderA, typename ColliderB>
+    bool GJKRaycast(
+            const ColliderA* colliderA, Transform* transformA,
+            const ColliderB* colliderB, Transform* transformB,
+            const QVector3D& direction, float maxT,
+            float& t, QVector3D& normal, QVector3D& point)
+    {
+        const float tolerance = 1e-3f;
+
+        auto support = [&](const QVector3D& d) {
+            SupportPoint p;
+            p.A = colliderA->FindFurthestPoint(transformA, -d);
+            p.B = colliderB->FindFurthestPoint(transformB,  d);
+            return p;
+        };
+
+        float lambda = 0;
+        QVector3D x;                 // current point on the ray
+        QVector3D n;
+
+        Simplex vertices;
+        float weights[4] = {1, 0, 0, 0};
+
+        SupportPoint first = support(direction);
+        QVector3D v = x - (first.B - first.A);
+
+        size_t iterations = 0;
+        while (v.lengthSquared() > tolerance * tolerance) {
+            if (iterations++ > 64u) return false;
+
+            SupportPoint p = support(v);
+            QVector3D w = x - (p.B - p.A);
+
+            float vw = QVector3D::dotProduct(v, w);
+            if (vw > 0) {
+                float vr = QVector3D::dotProduct(v, direction);
+                if (vr >= 0) return false;
+
+                lambda -= vw / vr;
+                if (lambda > maxT) return false;
+
+                x = lambda * direction;
+                n = v;
+            }
+
+            vertices.push_front(p);
+            for (size_t i = 0; i < vertices.size(); i++) {
+                vertices[i].C = x - (vertices[i].B - vertices[i].A);
+            }
+            if (!ClosestToOrigin(vertices, weights)) {
+                break; // x is inside the difference
+            }
+
+            v = QVector3D();
+            for (size_t i = 0; i < vertices.size(); i++) {
+                v += weights[i] * vertices[i].C;
+            }
+        }
+
+        t = lambda;
+        normal = n.lengthSquared() > 0 ? n.normalized() : -direction;
+        point = QVector3D();
+        for (size_t i = 0; i < vertices.size(); i++) {
+            point += weights[i] * vertices[i].B;
+        }
+        if (vertices.size() == 0) point = first.B;
+        return true;
+    }
+
+    // Moller-Trumbore, for plain rays against triangle geometry
+    inline bool RayTriangle(
+            const QVector3D& origin, const QVector3D& direction, float maxT,
+            const QVector3D v[3], float& t, QVector3D& normal)
+    {
+        QVector3D e1 = v[1] - v[0];
+        QVector3D e2 = v[2] - v[0];
+        QVector3D p = QVector3D::crossProduct(direction, e2);
+        float det = QVector3D::dotProduct(e1, p);
+        if (std::abs(det) < 1e-12f) return false;
+
+        float inv = 1.0f / det;
+        QVector3D s = origin - v[0];
+        float u = QVector3D::dotProduct(s, p) * inv;
+        if (u < 0 || u > 1) return false;
+
+        QVector3D q = QVector3D::crossProduct(s, e1);
+        float w = QVector3D::dotProduct(direction, q) * inv;
+        if (w < 0 || u + w > 1) return false;
+
+        t = QVector3D::dotProduct(e2, q) * inv;
+        if (t < 0 || t > maxT) return false;
+
+        normal = QVector3D::crossProduct(e1, e2).normalized();
+        if (QVector3D::dotProduct(normal, direction) > 0) normal = -normal;
+        return true;
+    }
+
+    template<typename Caster>
+    bool CastTriangle(
+            const Caster* caster, Transform* ct,
+            const QVector3D& direction, float maxT,
+            const QVector3D v[3], float& t, QVector3D& normal, QVector3D& point)
+    {
+        TriangleShape tri;
+        tri.V[0] = v[0];
+        tri.V[1] = v[1];
+        tri.V[2] = v[2];
+        return GJKRaycast(caster, ct, &tri, nullptr, direction, maxT, t, normal, point);
+    }
+
+    inline bool CastTriangle(
+            const PointShape* caster, Transform* /*ct*/,
+            const QVector3D& direction, float maxT,
+            const QVector3D v[3], float& t, QVector3D& normal, QVector3D& point)
+    {
+        if (!RayTriangle(caster->P, direction, maxT, v, t, normal)) return false;
+        point = caster->P + t * direction;
+        return true;
+    }
+
+    // Box swept by a caster over [0, maxT]
+    template<typename Caster>
+    AABB SweptBounds(const Caster* caster, Transform* ct, const QVector3D& direction, float maxT)
+    {
+        AABB box(
+            QVector3D(caster->FindFurthestPoint(ct, QVector3D(-1, 0, 0)).x(),
+                      caster->FindFurthestPoint(ct, QVector3D(0, -1, 0)).y(),
+                      caster->FindFurthestPoint(ct, QVector3D(0, 0, -1)).z()),
+            QVector3D(caster->FindFurthestPoint(ct, QVector3D(1, 0, 0)).x(),
+                      caster->FindFurthestPoint(ct, QVector3D(0, 1, 0)).y(),
+                      caster->FindFurthestPoint(ct, QVector3D(0, 0, 1)).z()));
+        if (maxT >= FLT_MAX) return AABB::Infinite();
+
+        AABB swept = box;
+        swept.Expand(AABB(box.Min + maxT * direction, box.Max + maxT * direction));
+        return swept;
+    }
+
+    // Calls visit(v, maxT) for the triangles of a mesh or heightfield the
+    // caster may hit, visit lowers maxT on a hit. A swept shape takes
+    // everything under its swept box.
+    template<typename Caster, typename F>
+    void CastCandidates(
+            const Caster* caster, Transform* ct,
+            const QVector3D& direction, float maxT,
+            const Collider* target, Transform* tt, F&& visit)
+    {
+        AABB box = SweptBounds(caster, ct, direction, maxT).Intersection(target->GetAABB(tt));
+        auto each = [&](const QVector3D v[3]) {
+            visit(v, maxT);
+        };
+        if (target->Type == ColliderType::MESH) {
+            ((const MeshCollider*)target)->ForEachTriangle(tt, box, each);
+        }
+        else {
+            ((const HeightfieldCollider*)target)->ForEachTriangle(tt, box, each);
+        }
+    }
+
+    // A ray walks the mesh's BVH or the heightfield's cells front to back
+    // and stops behind the first hit, a long ray doesn't touch every
+    // triangle under its box.
+    template<typename F>
+    void CastCandidates(
+            const PointShape* caster, Transform* /*ct*/,
+            const QVector3D& direction, float maxT,
+            const Collider* target, Transform* tt, F&& visit)
+    {
+        if (target->Type == ColliderType::MESH) {
+            ((const MeshCollider*)target)->Raycast(tt, caster->P, direction, maxT, visit);
+        }
+        else {
+            ((const HeightfieldCollider*)target)->Raycast(tt, caster->P, direction, maxT, visit);
+        }
+    }
+
+    // Casts caster along direction against one collider. Triangle
+    // sources and compounds only look at the parts under the swept box.
+    template<typename Caster>
+    bool CastCollider(
+            const Caster* caster, Transform* ct,
+            const QVector3D& direction, float maxT,
+            const Collider* target, Transform* tt,
+            float& t, QVector3D& normal, QVector3D& point)
+    {
+        switch (target->Type) {
+        case ColliderType::PLANE: {
+            const PlaneCollider* plane = (const PlaneCollider*)target;
+            QVector3D n = plane->Normal.normalized();
+            float offset = QVector3D::dotProduct(n, n * plane->Distance + tt->Position);
+
+            // the deepest point of the caster reaches the plane first
+            QVector3D deepest = caster->FindFurthestPoint(ct, -n);
+            float height = QVector3D::dotProduct(n, deepest) - offset;
+            float speed = QVector3D::dotProduct(n, direction);
+            if (height <= 0) {
+                t = 0;
+            }
+            else {
+                if (speed >= 0 || -height / speed > maxT) return false;
+                t = -height / speed;
+            }
+            normal = n;
+            point = deepest + t * direction - std::min(height, 0.0f) * n;
+            return true;
+        }
+        case ColliderType::SPHERE:
+            return GJKRaycast(caster, ct, (const SphereCollider*)target, tt, direction, maxT, t, normal, point);
+        case ColliderType::CAPSULE:
+            return GJKRaycast(caster, ct, (const CapsuleCollider*)target, tt, direction, maxT, t, normal, point);
+        case ColliderType::HULL:
+            return GJKRaycast(caster, ct, (const HullCollider*)target, tt, direction, maxT, t, normal, point);
+        case ColliderType::MESH:
+        case ColliderType::HEIGHTFIELD: {
+            bool hit = false;
+            CastCandidates(caster, ct, direction, maxT, target, tt, [&](const QVector3D v[3], float& limit) {
+                float triT;
+                QVector3D triNormal, triPoint;
+                if (CastTriangle(caster, ct, direction, limit, v, triT, triNormal, triPoint)) {
+                    hit = true;
+                    limit = t = triT;
+                    normal = triNormal;
+                    point = triPoint;
+                }
+            });
+            return hit;
+        }
+        case ColliderType::COMPOUND: {
+            const CompoundCollider* compound = (const CompoundCollider*)target;
+            bool hit = false;
+            AABB box = SweptBounds(caster, ct, direction, maxT).Intersection(target->GetAABB(tt));
+            compound->QueryChildren(tt, box, [&](int i) {
+                Transform child = compound->ChildTransform(tt, i);
+                float childT;
+                QVector3D childNormal, childPoint;
+                if (CastCollider(caster, ct, direction, maxT, compound->m_children[i].Shape, &child,
+                                 childT, childNormal, childPoint)) {
+                    hit = true;
+                    maxT = t = childT;
+                    normal = childNormal;
+                    point = childPoint;
+                }
+            });
+            return hit;
+        }
+        }
+        return false;
+    }
+
+}
+}
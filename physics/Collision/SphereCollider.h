@@ -5,7 +5,7 @@
 namespace physE {
 namespace impl {
 
-    struct SphereCollider
+    struct SphereCollider final
         : Collider
     {
     public:
@@ -0,0 +1,107 @@
+#ifndef CHAINCONSTRAINT_H
+#define CHAINCONSTRAINT_H
+
+#include <cmath>
+#include <vector>
+#include <QVector3D>
+#include "linkconstraints.h"
+
+// A rope: particles[i] and particles[i + 1] are held at rest[i]. All
+// segments are projected together, the system J W J^T of a chain is
+// tridiagonal, so one Newton step is an O(n) Thomas solve instead of many
+// Gauss-Seidel sweeps that move stretch one segment at a time.
+class ChainConstraint
+{
+public:
+    std::vector<int>   particles;
+    std::vector<float> rest;          // one per segment
+    int                max_iterations = 4;
+    float              tolerance      = 1e-4f;   // relative stretch
+
+    ChainConstraint() = default;
+
+    ChainConstraint(const ParticleStore& store, std::vector<int> ids)
+        : particles(std::move(ids))
+    {
+        for (size_t i = 0; i + 1 < particles.size(); ++i) {
+            rest.push_back((store.position[particles[i + 1]] - store.position[particles[i]]).length());
+        }
+    }
+
+    size_t segments() const
+    {
+        return rest.size();
+    }
+
+    // Newton steps until every segment is within tolerance
+    void project(ParticleStore& store)
+    {
+        for (int k = 0; k < max_iterations && solve(store) > tolerance; ++k) {}
+    }
+
+    // One linearized projection, returns the largest remaining relative
+    // stretch measured before the step.
+    float solve(ParticleStore& store)
+    {
+        const size_t m = segments();
+        if (m == 0) { return 0.0f; }
+        n.resize(m);
+        upper.resize(m);
+        rhs.resize(m);
+
+        QVector3D* x = store.position.data();
+        const float* w = store.inv_mass.data();
+
+        float error = 0.0f;
+        for (size_t i = 0; i < m; ++i) {
+            const QVector3D d = x[particles[i + 1]] - x[particles[i]];
+            const float dist = d.length();
+            n[i] = dist > 0.0f ? d / dist : QVector3D();
+            rhs[i] = rest[i] - dist;
+            error = std::max(error, std::abs(rest[i] - dist) / rest[i]);
+        }
+
+        // A = J W J^T: diagonal w_i + w_i+1, off diagonal -w_i+1 n_i.n_i+1.
+        // Forward elimination keeps the scaled upper diagonal in upper and
+        // the scaled right hand side in rhs.
+        double previous = 0.0;
+        for (size_t i = 0; i < m; ++i) {
+            const float w_a = w[particles[i]];
+            const float w_b = w[particles[i + 1]];
+            const double lower = i > 0 ? -w_a * double(QVector3D::dotProduct(n[i - 1], n[i])) : 0.0;
+            const double c = i + 1 < m ? -w_b * double(QVector3D::dotProduct(n[i], n[i + 1])) : 0.0;
+
+            double diagonal = w_a + w_b - lower * previous;
+            if (diagonal <= 1e-12f) {
+                // both ends pinned, the segment can't do anything
+                upper[i] = 0.0;
+                rhs[i] = 0.0;
+                previous = 0.0;
+                continue;
+            }
+            upper[i] = c / diagonal;
+            rhs[i] = (rhs[i] - lower * (i > 0 ? rhs[i - 1] : 0.0)) / diagonal;
+            previous = upper[i];
+        }
+        for (size_t i = m - 1; i-- > 0;) {
+            rhs[i] -= upper[i] * rhs[i + 1];
+        }
+
+        // dx = W J^T d_lambda, rhs now holds d_lambda
+        for (size_t i = 0; i <= m; ++i) {
+            QVector3D p;
+            if (i < m) p -= n[i] * float(rhs[i]);
+            if (i > 0) p += n[i - 1] * float(rhs[i - 1]);
+            x[particles[i]] += p * w[particles[i]];
+        }
+        return error;
+    }
+
+private:
+    // scratch, kept between solves
+    std::vector<QVector3D> n;
+    std::vector<double>    upper;  // doubles, thousands of segments
+    std::vector<double>    rhs;    // lose too much in float
+};
+
+#endif // CHAINCONSTRAINT_H
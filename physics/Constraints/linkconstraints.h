@@ -1,93 +1,147 @@
 #ifndef LINKCONSTRAINTS_H
 #define LINKCONSTRAINTS_H
 
+#include <algorithm>
+#include <mutex>
 #include <vector>
 #include <QVector3D>
 
-struct Particle
+// Particles as parallel arrays, index i of every array is particle i.
+// Passes over the particles stream through the arrays they need only.
+struct ParticleStore
 {
-    uint          id            = 0;
-    float        mass          = 1.0f;
-    bool         moving        = true;
-    QVector3D position;
-    QVector3D position_old;
-    QVector3D velocity;
-    QVector3D forces;
-
-    Particle() = default;
-
-    explicit
-    Particle(QVector3D pos)
-        : position(pos)
-        , position_old(pos)
-    {}
-
-    void update(float dt)
+    std::vector<QVector3D> position;
+    std::vector<QVector3D> position_old;
+    std::vector<QVector3D> velocity;
+    std::vector<float>     inv_mass;      // 0 pins the particle
+
+    size_t size() const
+    {
+        return position.size();
+    }
+
+    int add(QVector3D pos, float mass = 1.0f)
     {
-        if (!moving) return;
-        position_old = position;
-        velocity += (forces / mass) * dt;
-        position += velocity * dt;
+        const int id = position.size();
+        position.push_back(pos);
+        position_old.push_back(pos);
+        velocity.push_back(QVector3D());
+        inv_mass.push_back(1.0f / mass);
+        return id;
     }
 
-    void updateDerivatives(float dt)
+    void pin(int id)
     {
-        velocity = (position - position_old) / dt;
-        forces = {};
+        inv_mass[id] = 0.0f;
+        velocity[id] = QVector3D();
     }
 
-    void move(QVector3D v)
+    bool moving(int id) const
     {
-        if (!moving) return;
-        position += v;
+        return inv_mass[id] > 0.0f;
     }
 };
 
 
+// Structural links only pull, like a thread. Shear links run along the
+// diagonals of a cell and bending links skip one particle, both of them
+// resist compression as well.
+enum class LinkType
+{
+    Structural,
+    Shear,
+    Bending,
+};
+
 class LinkConstraint
 {
 public:
     uint id                          = 0;
-    Particle* particle_1;
-    Particle* particle_2;
+    int         particle_1           = -1;
+    int         particle_2           = -1;
     float       distance             = 1.0f;
-    float       strength             = 1.0f;
+    float       strength             = 1.0f;  // PBD only
+    float       compliance           = 0.0f;  // XPBD only, inverse stiffness
+    float       lambda               = 0.0f;  // XPBD multiplier, reset every substep
     float       max_elongation_ratio = 1.5f;
+    LinkType    type                 = LinkType::Structural;
     bool        broken               = false;
 
     LinkConstraint() = default;
 
-    LinkConstraint(Particle* p_1, Particle* p_2)
+    LinkConstraint(const ParticleStore& particles, int p_1, int p_2)
         : particle_1(p_1)
         , particle_2(p_2)
     {
-        distance = (p_1->position - p_2->position).length();
+        distance = (particles.position[p_1] - particles.position[p_2]).length();
     }
 
     [[nodiscard]]
     bool isValid() const
     {
-        return particle_2 && particle_1 && !broken;
+        return particle_1 >= 0 && particle_2 >= 0 && !broken;
     }
 
-    void solve()
+    // PBD scales the projection by strength, so stiffness depends on the
+    // iteration count. XPBD accumulates lambda against the compliance
+    // scaled by 1 / dt^2 of the substep, which makes it independent.
+    void solve(ParticleStore& particles, bool xpbd = false, float inv_dt2 = 0.0f)
     {
         if (!isValid()) { return; }
-        Particle& p_1 = *particle_1;
-        Particle& p_2 = *particle_2;
-        const QVector3D v = p_1.position - p_2.position;
+        if (!xpbd && type != LinkType::Structural) { return; }
+        QVector3D& x_1 = particles.position[particle_1];
+        QVector3D& x_2 = particles.position[particle_2];
+        const float w_1 = particles.inv_mass[particle_1];
+        const float w_2 = particles.inv_mass[particle_2];
+        if (w_1 + w_2 == 0.0f) { return; }
+
+        const QVector3D v = x_1 - x_2;
         const float dist = v.length();
-        if (dist > distance) {
-            // 距离超出阈值时连接断开
-            broken = dist > distance * max_elongation_ratio;
-            const QVector3D n = v / dist;
-            const float c = distance - dist;
-            const QVector3D p = -(c * strength) / (p_1.mass + p_2.mass) * n;
-            // Apply position correction
-            p_1.move(-p / p_1.mass);
-            p_2.move( p / p_2.mass);
+        if (dist == 0.0f) { return; }
+        // 距离超出阈值时连接断开
+        if (dist > distance * max_elongation_ratio) { broken = true; }
+
+        const float alpha = xpbd ? compliance * inv_dt2 : 0.0f;
+        const float c = dist - distance;
+        float d_lambda = (-(xpbd ? 1.0f : strength) * c - alpha * lambda) / (w_1 + w_2 + alpha);
+        if (type == LinkType::Structural) {
+            d_lambda = std::min(d_lambda, -lambda);
         }
+        if (xpbd) { lambda += d_lambda; }
+
+        // Apply position correction, split by inverse mass
+        const QVector3D p = d_lambda / dist * v;
+        x_1 += p * w_1;
+        x_2 -= p * w_2;
     }
 };
 
+// Indices of the links that broke during a solve. Solver threads add to
+// it, so breaking costs nothing until something actually tears.
+class BrokenLinks
+{
+public:
+    void add(int link)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_links.push_back(link);
+    }
+
+    bool empty() const
+    {
+        return m_links.empty();
+    }
+
+    // Hands the collected links over and starts a new list
+    void take(std::vector<int>& links)
+    {
+        links.clear();
+        links.swap(m_links);
+    }
+
+private:
+    std::mutex       m_mutex;
+    std::vector<int> m_links;
+};
+
 #endif // LINKCONSTRAINTS_H
@@ -9,7 +9,7 @@ class ImpluseSolveer
 {
 public:
     void Solve(
-        std::vector<Collision>& collisions,
+        FrameVector<Collision>& collisions,
         float dt)  override
     {
         for (Collision& collision : collisions) {
@@ -19,18 +19,22 @@ public:
             QVector3D rb = QVector3D();
             if(collision.Points.ContactPoint.length() != 0)
             {
-                ra = /*QVector3D();//*/collision.Points.ContactPoint - collision.ObjA->Transform->Position;
-                rb = /*QVector3D();//*/collision.Points.ContactPoint - collision.ObjB->Transform->Position;
+                ra = /*QVector3D();//*/collision.Points.ContactPoint - collision.ObjA->WorldCenterOfMass();
+                rb = /*QVector3D();//*/collision.Points.ContactPoint - collision.ObjB->WorldCenterOfMass();
             }
 
             Object* aBody = collision.ObjA->IsDynamic ? collision.ObjA : nullptr;
             Object* bBody = collision.ObjB->IsDynamic ? collision.ObjB : nullptr;
 
-            QVector3D aVel = aBody? aBody->Velocity:QVector3D(0,0,0);
-            QVector3D bVel = bBody? bBody->Velocity:QVector3D(0,0,0);
+            // kinematic bodies take no impulse but their motion still counts
+            const bool aMoves = aBody || collision.ObjA->IsKinematic;
+            const bool bMoves = bBody || collision.ObjB->IsKinematic;
 
-            QVector3D aAngVel = aBody? aBody->angularVelocity:QVector3D(0,0,0);
-            QVector3D bAngVel = bBody? bBody->angularVelocity:QVector3D(0,0,0);
+            QVector3D aVel = aMoves? collision.ObjA->Velocity:QVector3D(0,0,0);
+            QVector3D bVel = bMoves? collision.ObjB->Velocity:QVector3D(0,0,0);
+
+            QVector3D aAngVel = aMoves? collision.ObjA->angularVelocity:QVector3D(0,0,0);
+            QVector3D bAngVel = bMoves? collision.ObjB->angularVelocity:QVector3D(0,0,0);
 
             QVector3D rVel = bVel - aVel + QVector3D::crossProduct(bAngVel, rb) - QVector3D::crossProduct(aAngVel, ra);
 
@@ -43,14 +47,19 @@ public:
             float inv_massA = aMass? 1 / aMass:0;
             float inv_massB = bMass? 1 / bMass:0;
 
-            float aI = aBody? aBody->I:0;
-            float bI = bBody? bBody->I:0;
-            float inv_iA = aI? 1 / aI:0;
-            float inv_iB = bI? 1 / bI:0;
+            const QMatrix4x4 zero(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+            const QMatrix4x4& inv_iA = aBody ? aBody->InvInertiaWorld : zero;
+            const QMatrix4x4& inv_iB = bBody ? bBody->InvInertiaWorld : zero;
 
-            QVector3D raCrossN = QVector3D::crossProduct( ra, collision.Points.Normal );
-            QVector3D rbCrossN = QVector3D::crossProduct( rb, collision.Points.Normal );
-            float invMassSum =inv_massA + inv_massB + sqrt( raCrossN.length() ) * inv_iA + sqrt( rbCrossN.length() ) * inv_iB;
+            // 1 / (n . K n), K = m^-1 + [r]^T I^-1 [r] summed over both bodies
+            auto effectiveMass = [&](const QVector3D& dir) {
+                QVector3D raCrossD = QVector3D::crossProduct(ra, dir);
+                QVector3D rbCrossD = QVector3D::crossProduct(rb, dir);
+                return inv_massA + inv_massB
+                     + QVector3D::dotProduct(raCrossD, inv_iA.mapVector(raCrossD))
+                     + QVector3D::dotProduct(rbCrossD, inv_iB.mapVector(rbCrossD));
+            };
+            float invMassSum = effectiveMass(collision.Points.Normal);
 
 
             float e = (aBody ? .5 : 1.0f)
@@ -61,12 +70,12 @@ public:
 
             if (aBody) {
                 aVel -= impluse * inv_massA;
-                aAngVel += inv_iA * QVector3D::crossProduct(ra, -impluse);
+                aAngVel += inv_iA.mapVector(QVector3D::crossProduct(ra, -impluse));
             }
 
             if (bBody) {
                 bVel += impluse * inv_massB;
-                bAngVel += inv_iB * QVector3D::crossProduct(rb, impluse);
+                bAngVel += inv_iB.mapVector(QVector3D::crossProduct(rb, impluse));
             }
 
             // Friction
@@ -88,7 +97,7 @@ public:
             float bDF = bBody ? .8 : 0.0f;
             float mu  = (float)QVector2D(aSF, bSF).length();
 
-            float f  = -fVel / invMassSum;
+            float f  = -fVel / effectiveMass(tangent);
 
             QVector3D friction;
             if (abs(f) < j * mu) {
@@ -109,15 +118,15 @@ public:
             //qDebug()<<collision.Points.Depth<<", "<<collision.Points.Normal;
             if(aBody)
             {
-                aBody->Velocity = aVel - friction * aMass;
-                aBody->angularVelocity = aAngVel + inv_iA * QVector3D::crossProduct(ra, -friction);
+                aBody->Velocity = aVel - friction * inv_massA;
+                aBody->angularVelocity = aAngVel + inv_iA.mapVector(QVector3D::crossProduct(ra, -friction));
                 aBody->Transform->Position -= inv_massA * correction;
             }
 
             if(bBody)
             {
-                bBody->Velocity = bVel + friction * bMass;
-                bBody->angularVelocity = bAngVel + inv_iB * QVector3D::crossProduct(rb, friction);
+                bBody->Velocity = bVel + friction * inv_massB;
+                bBody->angularVelocity = bAngVel + inv_iB.mapVector(QVector3D::crossProduct(rb, friction));
                 bBody->Transform->Position += inv_massB * correction;
             }
         }
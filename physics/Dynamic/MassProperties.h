@@ -0,0 +1,161 @@
+#pragma once
+
+#include "physics/Collision/CollisionObject.h"
+#include "physics/Collision/SphereCollider.h"
+#include "physics/Collision/CapsuleCollider.h"
+#include "physics/Collision/HullCollider.h"
+#include "physics/Collision/CompoundCollider.h"
+
+namespace physE {
+
+namespace impl {
+
+    inline QMatrix4x4 InertiaFromCovariance(const double C[3][3])
+    {
+        const double trace = C[0][0] + C[1][1] + C[2][2];
+        QMatrix4x4 I;
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                I(r, c) = float((r == c ? trace : 0.0) - C[r][c]);
+            }
+        }
+        return I;
+    }
+
+    // Solid hull of uniform density. The hull is split into tetrahedra from
+    // its vertex centroid to every triangle and their covariance matrices are
+    // summed (Blow and Binstock); triangles are oriented outwards first so
+    // hand written index lists with mixed winding work too.
+    inline MassProperties HullMassProperties(const HullCollider& hull, float density)
+    {
+        MassProperties props;
+        if (hull.m_data.empty()) return props;
+
+        QVector3D ref;
+        for (const VerNorm& v : hull.m_data) {
+            ref += v.Vertex;
+        }
+        ref /= float(hull.m_data.size());
+
+        double volume = 0;
+        double com[3] = {0, 0, 0};
+        double C[3][3] = {};
+        for (size_t t = 0; t + 2 < hull.m_index.size(); t += 3) {
+            QVector3D a = hull.m_data[hull.m_index[t    ]].Vertex - ref;
+            QVector3D b = hull.m_data[hull.m_index[t + 1]].Vertex - ref;
+            QVector3D c = hull.m_data[hull.m_index[t + 2]].Vertex - ref;
+
+            double det = QVector3D::dotProduct(a, QVector3D::crossProduct(b, c));
+            if (det < 0) {
+                std::swap(b, c);
+                det = -det;
+            }
+
+            QVector3D sum = a + b + c;
+            volume += det / 6;
+            for (int r = 0; r < 3; r++) {
+                com[r] += det / 24 * sum[r];
+                for (int k = 0; k < 3; k++) {
+                    C[r][k] += det / 120 * (a[r] * a[k] + b[r] * b[k] + c[r] * c[k] + sum[r] * sum[k]);
+                }
+            }
+        }
+        if (volume <= 0) return props;
+
+        // move the covariance from the reference point to the center of mass
+        for (int r = 0; r < 3; r++) {
+            com[r] /= volume;
+        }
+        for (int r = 0; r < 3; r++) {
+            for (int k = 0; k < 3; k++) {
+                C[r][k] = density * (C[r][k] - volume * com[r] * com[k]);
+            }
+        }
+
+        props.Mass = float(density * volume);
+        props.CenterOfMass = ref + QVector3D(com[0], com[1], com[2]);
+        props.Inertia = InertiaFromCovariance(C);
+        return props;
+    }
+
+    inline MassProperties SphereMassProperties(const SphereCollider& sphere, float density)
+    {
+        const float pi = 3.14159265f;
+        const float r = sphere.Radius;
+
+        MassProperties props;
+        props.Mass = density * 4.0f / 3.0f * pi * r * r * r;
+        props.CenterOfMass = sphere.Center;
+        props.Inertia(0, 0) = props.Inertia(1, 1) = props.Inertia(2, 2) = 0.4f * props.Mass * r * r;
+        return props;
+    }
+
+    inline MassProperties CapsuleMassProperties(const CapsuleCollider& capsule, float density)
+    {
+        const float pi = 3.14159265f;
+        const float r = capsule.Radius;
+        const float h = 2 * capsule.HalfHeight;
+
+        const float cylinder = density * pi * r * r * h;
+        const float spheres  = density * 4.0f / 3.0f * pi * r * r * r;
+
+        MassProperties props;
+        props.Mass = cylinder + spheres;
+        props.CenterOfMass = capsule.Center;
+        props.Inertia(0, 0) = cylinder * (h * h / 12 + r * r / 4)
+                            + spheres * (0.4f * r * r + h * h / 4 + 3 * h * r / 8);
+        props.Inertia(1, 1) = cylinder * r * r / 2 + spheres * 0.4f * r * r;
+        props.Inertia(2, 2) = props.Inertia(0, 0);
+        return props;
+    }
+
+    inline MassProperties ComputeMassProperties(const Collider* collider, float density);
+
+    // Children are rotated into the compound frame and shifted to the
+    // common center of mass with the parallel axis theorem.
+    inline MassProperties CompoundMassProperties(const CompoundCollider& compound, float density)
+    {
+        MassProperties props;
+        std::vector<MassProperties> parts(compound.m_children.size());
+        QVector3D com;
+        for (size_t i = 0; i < parts.size(); i++) {
+            const CompoundChild& child = compound.m_children[i];
+            parts[i] = ComputeMassProperties(child.Shape, density);
+            parts[i].CenterOfMass = child.Local.Rotation.mapVector(parts[i].CenterOfMass) + child.Local.Position;
+            props.Mass += parts[i].Mass;
+            com += parts[i].Mass * parts[i].CenterOfMass;
+        }
+        if (props.Mass <= 0) return props;
+
+        props.CenterOfMass = com / props.Mass;
+        props.Inertia = QMatrix4x4();
+        props.Inertia(0, 0) = props.Inertia(1, 1) = props.Inertia(2, 2) = 0;
+        for (size_t i = 0; i < parts.size(); i++) {
+            const QMatrix4x4& R = compound.m_children[i].Local.Rotation;
+            QMatrix4x4 I = R * parts[i].Inertia * R.transposed();
+            QVector3D d = parts[i].CenterOfMass - props.CenterOfMass;
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < 3; c++) {
+                    props.Inertia(r, c) += I(r, c)
+                        + parts[i].Mass * ((r == c ? d.lengthSquared() : 0) - d[r] * d[c]);
+                }
+            }
+        }
+        return props;
+    }
+
+    // Planes, meshes and heightfields are static only and get no mass
+    inline MassProperties ComputeMassProperties(const Collider* collider, float density)
+    {
+        switch (collider->Type) {
+        case ColliderType::SPHERE:   return SphereMassProperties  (*(const SphereCollider*)  collider, density);
+        case ColliderType::CAPSULE:  return CapsuleMassProperties (*(const CapsuleCollider*) collider, density);
+        case ColliderType::HULL:     return HullMassProperties    (*(const HullCollider*)    collider, density);
+        case ColliderType::COMPOUND: return CompoundMassProperties(*(const CompoundCollider*)collider, density);
+        default:                     return MassProperties();
+        }
+    }
+
+}
+
+}
@@ -6,8 +6,10 @@ namespace physE {
 
 class Solver {
 public:
+    virtual ~Solver() = default;
+
     virtual void Solve(
-        std::vector<Collision>& collisions,
+        FrameVector<Collision>& collisions,
         float dt) = 0;
 };
 
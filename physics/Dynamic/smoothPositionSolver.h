@@ -10,10 +10,11 @@ class SmoothPositionSolver
 {
 public:
    void Solve(
-       std::vector<Collision>& collisions,
+       FrameVector<Collision>& collisions,
        float dt)  override
     {
-        std::vector<std::pair<QVector3D, QVector3D>> deltas;
+        FrameVector<std::pair<QVector3D, QVector3D>> deltas;
+        deltas.reserve(collisions.size());
 
         for (Collision& collision : collisions) {
             Object* aBody = collision.ObjA->IsDynamic ? collision.ObjA : nullptr;
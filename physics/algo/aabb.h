@@ -0,0 +1,101 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <QVector3D>
+#include <cfloat>
+#include <algorithm>
+
+namespace physE {
+
+    /** @brief Axis aligned bounding box.
+     */
+    struct AABB
+    {
+        QVector3D Min;
+        QVector3D Max;
+
+        AABB()
+            : Min( FLT_MAX,  FLT_MAX,  FLT_MAX)
+            , Max(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+        {}
+
+        AABB(const QVector3D& min, const QVector3D& max)
+            : Min(min)
+            , Max(max)
+        {}
+
+        static AABB Infinite()
+        {
+            return AABB(QVector3D(-FLT_MAX, -FLT_MAX, -FLT_MAX),
+                        QVector3D( FLT_MAX,  FLT_MAX,  FLT_MAX));
+        }
+
+        bool IsEmpty() const
+        {
+            return Min.x() > Max.x() || Min.y() > Max.y() || Min.z() > Max.z();
+        }
+
+        bool IsInfinite() const
+        {
+            return Min.x() == -FLT_MAX || Max.x() == FLT_MAX;
+        }
+
+        void Expand(const QVector3D& p)
+        {
+            Min = QVector3D(std::min(Min.x(), p.x()), std::min(Min.y(), p.y()), std::min(Min.z(), p.z()));
+            Max = QVector3D(std::max(Max.x(), p.x()), std::max(Max.y(), p.y()), std::max(Max.z(), p.z()));
+        }
+
+        void Expand(const AABB& b)
+        {
+            Expand(b.Min);
+            Expand(b.Max);
+        }
+
+        AABB Inflated(float margin) const
+        {
+            QVector3D m(margin, margin, margin);
+            return AABB(Min - m, Max + m);
+        }
+
+        AABB Intersection(const AABB& b) const
+        {
+            return AABB(
+                QVector3D(std::max(Min.x(), b.Min.x()), std::max(Min.y(), b.Min.y()), std::max(Min.z(), b.Min.z())),
+                QVector3D(std::min(Max.x(), b.Max.x()), std::min(Max.y(), b.Max.y()), std::min(Max.z(), b.Max.z())));
+        }
+
+        bool Overlaps(const AABB& b) const
+        {
+            return Min.x() <= b.Max.x() && Max.x() >= b.Min.x()
+                && Min.y() <= b.Max.y() && Max.y() >= b.Min.y()
+                && Min.z() <= b.Max.z() && Max.z() >= b.Min.z();
+        }
+
+        bool Contains(const QVector3D& p) const
+        {
+            return p.x() >= Min.x() && p.x() <= Max.x()
+                && p.y() >= Min.y() && p.y() <= Max.y()
+                && p.z() >= Min.z() && p.z() <= Max.z();
+        }
+
+        QVector3D Center() const
+        {
+            return (Min + Max) * 0.5f;
+        }
+
+        QVector3D Extent() const
+        {
+            return Max - Min;
+        }
+
+        float SurfaceArea() const
+        {
+            QVector3D e = Extent();
+            return 2.0f * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+        }
+    };
+
+}
+
+#endif // AABB_H
@@ -0,0 +1,134 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace physE {
+
+    namespace {
+        const size_t MinBlockSize = 64 * 1024;
+
+        std::atomic<quint64> s_heapAllocations(0);
+    }
+
+    std::atomic<quint64> FrameArena::s_frame(1);
+
+    FrameArena::~FrameArena()
+    {
+        for (Block& block : m_blocks) {
+            std::free(block.Data);
+        }
+    }
+
+    FrameArena& FrameArena::Local()
+    {
+        thread_local FrameArena arena;
+        return arena;
+    }
+
+    void FrameArena::BeginFrame()
+    {
+        s_frame.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* FrameArena::Allocate(size_t bytes, size_t align)
+    {
+        const quint64 frame = s_frame.load(std::memory_order_relaxed);
+        if (m_frame != frame) {
+            m_frame = frame;
+            Rewind();
+        }
+
+        size_t offset = (m_offset + align - 1) & ~(align - 1);
+        if (!m_top || offset + bytes > m_size) {
+            Grow(bytes + align);
+            offset = (m_offset + align - 1) & ~(align - 1);
+        }
+
+        void* p = m_top + offset;
+        m_offset = offset + bytes;
+        return p;
+    }
+
+    void FrameArena::Deallocate(void* p, size_t bytes)
+    {
+        if ((char*)p + bytes == m_top + m_offset) {
+            m_offset = (char*)p - m_top;
+        }
+    }
+
+    void FrameArena::Rewind()
+    {
+        if (m_blocks.size() > 1) {
+            // the last frame did not fit, replace all blocks with one
+            for (Block& block : m_blocks) {
+                std::free(block.Data);
+            }
+            m_blocks.clear();
+            m_top = nullptr;
+
+            const size_t size = m_capacity;
+            m_capacity = 0;
+            Grow(size);
+        }
+        m_used = 0;
+        m_offset = 0;
+    }
+
+    void FrameArena::Grow(size_t bytes)
+    {
+        size_t size = std::max(MinBlockSize, std::max(bytes, m_capacity));
+        char* data = (char*)std::malloc(size);
+        if (!data) throw std::bad_alloc();
+
+        if (m_top) m_used += m_offset;
+        m_blocks.push_back({data, size});
+        m_top = data;
+        m_size = size;
+        m_offset = 0;
+        m_capacity += size;
+    }
+
+    quint64 HeapAllocations()
+    {
+        return s_heapAllocations.load(std::memory_order_relaxed);
+    }
+
+}
+
+#ifdef WFPE_COUNT_ALLOCATIONS
+
+void* operator new(size_t size)
+{
+    physE::s_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
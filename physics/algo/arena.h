@@ -0,0 +1,111 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <QtGlobal>
+
+namespace physE {
+
+    /** @brief Linear allocator for memory that only lives for one step.
+     *
+     *  Every thread has its own arena (FrameArena::Local). BeginFrame starts a
+     *  new frame for all of them at once; each arena rewinds lazily on its
+     *  next allocation, so worker threads never need to be told. Nothing is
+     *  freed individually. When a frame overflowed into extra blocks they are
+     *  merged into one big enough block at the rewind, so after the first few
+     *  steps a frame is served without touching the heap at all.
+     */
+    class FrameArena
+    {
+    public:
+        FrameArena() = default;
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator = (const FrameArena&) = delete;
+        ~FrameArena();
+
+        /** @brief Arena of the calling thread.
+         */
+        static FrameArena& Local();
+
+        /** @brief Starts a new frame, memory handed out before must not be used any more.
+         */
+        static void BeginFrame();
+
+        void* Allocate(size_t bytes, size_t align);
+
+        /** @brief Gives the memory back if it is the latest allocation, so a
+         *  growing container can reuse it. Does nothing otherwise.
+         */
+        void Deallocate(void* p, size_t bytes);
+
+        size_t Used() const     { return m_used + m_offset; }
+        size_t Capacity() const { return m_capacity; }
+
+    private:
+        struct Block
+        {
+            char*  Data;
+            size_t Size;
+        };
+
+        void Rewind();
+        void Grow(size_t bytes);
+
+        std::vector<Block> m_blocks;
+        char*  m_top = nullptr;    // current block
+        size_t m_size = 0;
+        size_t m_offset = 0;
+        size_t m_used = 0;         // in blocks before the current one
+        size_t m_capacity = 0;
+        quint64 m_frame = 0;
+
+        static std::atomic<quint64> s_frame;
+    };
+
+    /** @brief std allocator on top of the arena of the thread that created it.
+     *  Containers using it must not outlive the step.
+     */
+    template<typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        ArenaAllocator() : m_arena(&FrameArena::Local()) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& b) : m_arena(b.m_arena) {}
+
+        T* allocate(size_t n)
+        {
+            return (T*)m_arena->Allocate(n * sizeof(T), alignof(T));
+        }
+
+        void deallocate(T* p, size_t n)
+        {
+            m_arena->Deallocate(p, n * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator == (const ArenaAllocator<U>& b) const { return m_arena == b.m_arena; }
+        template<typename U>
+        bool operator != (const ArenaAllocator<U>& b) const { return m_arena != b.m_arena; }
+
+    private:
+        template<typename U> friend class ArenaAllocator;
+        FrameArena* m_arena;
+    };
+
+    template<typename T>
+    using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+    /** @brief Number of global operator new calls so far. Only counts when
+     *  built with WFPE_COUNT_ALLOCATIONS, always 0 otherwise.
+     */
+    quint64 HeapAllocations();
+
+}
+
+#endif // ARENA_H
@@ -0,0 +1,185 @@
+#include "bvh.h"
+
+namespace physE {
+
+    namespace {
+
+        const int BinCount = 8;
+        // keeps the traversal stack in BVH::Query bounded
+        const int MaxSAHDepth = 32;
+
+        void SetBounds(BVHNode& node, const AABB& box)
+        {
+            node.Min[0] = box.Min.x(); node.Min[1] = box.Min.y(); node.Min[2] = box.Min.z();
+            node.Max[0] = box.Max.x(); node.Max[1] = box.Max.y(); node.Max[2] = box.Max.z();
+        }
+
+        struct BuildTask
+        {
+            int node;
+            int depth;
+        };
+    }
+
+    void BVH::Build(const std::vector<AABB>& bounds, int maxLeafSize)
+    {
+        Clear();
+        if (bounds.empty()) return;
+
+        const int count = bounds.size();
+        m_indices.resize(count);
+        std::vector<QVector3D> centroids(count);
+        for (int i = 0; i < count; i++) {
+            m_indices[i] = i;
+            centroids[i] = bounds[i].Center();
+        }
+
+        m_nodes.reserve(2 * count);
+        m_nodes.push_back(BVHNode());
+        m_nodes[0].LeftFirst = 0;
+        m_nodes[0].Count = count;
+
+        std::vector<BuildTask> tasks;
+        tasks.push_back({0, 0});
+        while (!tasks.empty()) {
+            BuildTask task = tasks.back();
+            tasks.pop_back();
+
+            const int first = m_nodes[task.node].LeftFirst;
+            const int n     = m_nodes[task.node].Count;
+
+            AABB box;
+            AABB centroidBox;
+            for (int i = first; i < first + n; i++) {
+                box.Expand(bounds[m_indices[i]]);
+                centroidBox.Expand(centroids[m_indices[i]]);
+            }
+            SetBounds(m_nodes[task.node], box);
+
+            if (n <= maxLeafSize) continue;
+
+            QVector3D extent = centroidBox.Extent();
+            int axis = 0;
+            if (extent[1] > extent[axis]) axis = 1;
+            if (extent[2] > extent[axis]) axis = 2;
+            if (extent[axis] <= 0) continue; // all centroids coincide
+
+            // binned SAH along the longest centroid axis
+            float lo = centroidBox.Min[axis];
+            float scale = BinCount / extent[axis];
+            int split = -1;
+
+            if (task.depth < MaxSAHDepth) {
+                AABB binBox[BinCount];
+                int  binCount[BinCount] = {};
+                for (int i = first; i < first + n; i++) {
+                    int b = std::min(BinCount - 1, int((centroids[m_indices[i]][axis] - lo) * scale));
+                    binBox[b].Expand(bounds[m_indices[i]]);
+                    binCount[b]++;
+                }
+
+                float leftArea[BinCount - 1];
+                int   leftCount[BinCount - 1];
+                AABB acc;
+                int sum = 0;
+                for (int b = 0; b < BinCount - 1; b++) {
+                    acc.Expand(binBox[b]);
+                    sum += binCount[b];
+                    leftArea[b]  = sum ? acc.SurfaceArea() : 0;
+                    leftCount[b] = sum;
+                }
+
+                float bestCost = n * box.SurfaceArea();
+                acc = AABB();
+                sum = 0;
+                for (int b = BinCount - 1; b > 0; b--) {
+                    acc.Expand(binBox[b]);
+                    sum += binCount[b];
+                    float cost = leftCount[b - 1] * leftArea[b - 1] + sum * acc.SurfaceArea();
+                    if (leftCount[b - 1] && sum && cost < bestCost) {
+                        bestCost = cost;
+                        split = b;
+                    }
+                }
+
+                // splitting would not pay off and the leaf is still small
+                if (split < 0 && n <= 4 * maxLeafSize) continue;
+            }
+
+            int mid;
+            if (split >= 0) {
+                int* it = std::partition(m_indices.data() + first, m_indices.data() + first + n, [&](int i) {
+                    return std::min(BinCount - 1, int((centroids[i][axis] - lo) * scale)) < split;
+                });
+                mid = int(it - m_indices.data());
+            }
+            else {
+                mid = first + n / 2;
+                std::nth_element(m_indices.data() + first, m_indices.data() + mid, m_indices.data() + first + n, [&](int a, int b) {
+                    return centroids[a][axis] < centroids[b][axis];
+                });
+            }
+
+            const int left = m_nodes.size();
+            m_nodes.push_back(BVHNode());
+            m_nodes.push_back(BVHNode());
+            m_nodes[left].LeftFirst     = first;
+            m_nodes[left].Count         = mid - first;
+            m_nodes[left + 1].LeftFirst = mid;
+            m_nodes[left + 1].Count     = first + n - mid;
+
+            m_nodes[task.node].LeftFirst = left;
+            m_nodes[task.node].Count     = 0;
+
+            tasks.push_back({left,     task.depth + 1});
+            tasks.push_back({left + 1, task.depth + 1});
+        }
+    }
+
+    bool BVH::IsValid(int primitives) const
+    {
+        if (m_nodes.empty()) return m_indices.empty();
+
+        for (int index : m_indices) {
+            if (index < 0 || index >= primitives) return false;
+        }
+
+        // children come after their parent, so one pass sees every parent
+        // first and no node can be its own ancestor
+        const int count = m_nodes.size();
+        std::vector<int> depth(count, 0);
+        for (int i = 0; i < count; i++) {
+            const BVHNode& node = m_nodes[i];
+            if (node.Count < 0 || node.LeftFirst < 0) return false;
+            if (node.IsLeaf()) {
+                if (node.LeftFirst > int(m_indices.size()) - node.Count) return false;
+                continue;
+            }
+            if (node.LeftFirst <= i || node.LeftFirst >= count - 1) return false;
+            // the traversal stack holds at most depth + 1 entries
+            if (depth[i] + 2 > 64) return false;
+            depth[node.LeftFirst] = depth[node.LeftFirst + 1] = depth[i] + 1;
+        }
+        return true;
+    }
+
+    void BVH::Refit(const std::vector<AABB>& bounds)
+    {
+        // children are always stored after their parent
+        for (int i = int(m_nodes.size()) - 1; i >= 0; i--) {
+            BVHNode& node = m_nodes[i];
+            AABB box;
+            if (node.IsLeaf()) {
+                for (int k = node.LeftFirst; k < node.LeftFirst + node.Count; k++) {
+                    box.Expand(bounds[m_indices[k]]);
+                }
+            }
+            else {
+                box.Expand(m_nodes[node.LeftFirst].Bounds());
+                box.Expand(m_nodes[node.LeftFirst + 1].Bounds());
+            }
+            SetBounds(node, box);
+        }
+    }
+
+}
@@ -0,0 +1,176 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include "aabb.h"
+
+namespace physE {
+
+    /** @brief Flat BVH node, 32 bytes. Children of an inner node are stored
+     *  next to each other, so only the index of the left one is kept.
+     */
+    struct BVHNode
+    {
+        float Min[3];
+        int   LeftFirst; //!< left child for inner nodes, first index for leaves
+        float Max[3];
+        int   Count;     //!< number of primitives, 0 for inner nodes
+
+        bool IsLeaf() const { return Count > 0; }
+
+        AABB Bounds() const
+        {
+            return AABB(QVector3D(Min[0], Min[1], Min[2]),
+                        QVector3D(Max[0], Max[1], Max[2]));
+        }
+
+        bool Overlaps(const AABB& b) const
+        {
+            return Min[0] <= b.Max.x() && Max[0] >= b.Min.x()
+                && Min[1] <= b.Max.y() && Max[1] >= b.Min.y()
+                && Min[2] <= b.Max.z() && Max[2] >= b.Min.z();
+        }
+
+        /** @brief Slab test against origin + t * direction, 0 <= t <= maxT.
+         *  @param[in] inv component wise inverse of the direction
+         *  @param[out] t where the segment enters the box, 0 if it starts inside
+         */
+        bool Intersects(const QVector3D& origin, const QVector3D& inv, float maxT, float& t) const
+        {
+            float tMin = 0;
+            float tMax = maxT;
+            for (int k = 0; k < 3; k++) {
+                float t0 = (Min[k] - origin[k]) * inv[k];
+                float t1 = (Max[k] - origin[k]) * inv[k];
+                if (t0 > t1) std::swap(t0, t1);
+                // written so a NaN from 0 * inf leaves the interval alone
+                tMin = t0 > tMin ? t0 : tMin;
+                tMax = t1 < tMax ? t1 : tMax;
+                if (tMin > tMax) return false;
+            }
+            t = tMin;
+            return true;
+        }
+    };
+
+    /** @brief Bounding volume hierarchy over a set of primitive boxes, built
+     *  top-down with binned SAH and stored as one contiguous node array.
+     */
+    class BVH
+    {
+    public:
+        std::vector<BVHNode> m_nodes;
+        std::vector<int>     m_indices; //!< primitive indices, grouped by leaf
+
+        /** @brief Builds the tree.
+         *  @param[in] bounds the box of every primitive
+         *  @param[in] maxLeafSize nodes with at most this many primitives always become leaves
+         */
+        void Build(const std::vector<AABB>& bounds, int maxLeafSize = 4);
+
+        /** @brief Recomputes the node boxes for moved primitives, keeping the
+         *  topology. Much cheaper than Build, but the tree degrades if the
+         *  primitives move far from where it was built.
+         */
+        void Refit(const std::vector<AABB>& bounds);
+
+        /** @brief Checks a tree that did not come from Build, e.g. one read
+         *  from a file: every child and leaf range in bounds, every index below
+         *  primitives and the depth within the traversal stack.
+         */
+        bool IsValid(int primitives) const;
+
+        void Clear()
+        {
+            m_nodes.clear();
+            m_indices.clear();
+        }
+
+        bool IsEmpty() const
+        {
+            return m_nodes.empty();
+        }
+
+        AABB Bounds() const
+        {
+            return m_nodes.empty() ? AABB() : m_nodes[0].Bounds();
+        }
+
+        /** @brief Calls visit(primitive) for every primitive whose leaf box
+         *  overlaps the query box.
+         */
+        template<typename F>
+        void Query(const AABB& box, F&& visit) const
+        {
+            if (m_nodes.empty()) return;
+
+            int stack[64];
+            int top = 0;
+            stack[top++] = 0;
+            while (top) {
+                const BVHNode& node = m_nodes[stack[--top]];
+                if (!node.Overlaps(box)) continue;
+
+                if (node.IsLeaf()) {
+                    for (int i = 0; i < node.Count; i++) {
+                        visit(m_indices[node.LeftFirst + i]);
+                    }
+                }
+                else {
+                    stack[top++] = node.LeftFirst + 1;
+                    stack[top++] = node.LeftFirst;
+                }
+            }
+        }
+
+        /** @brief Calls visit(primitive, maxT) for every primitive whose leaf
+         *  box the segment origin + t * direction, 0 <= t <= maxT, passes
+         *  through, nearer children first. visit may lower maxT to cut off
+         *  everything behind a hit.
+         */
+        template<typename F>
+        void Raycast(const QVector3D& origin, const QVector3D& direction, float maxT, F&& visit) const
+        {
+            if (m_nodes.empty()) return;
+
+            const QVector3D inv(1.0f / direction.x(), 1.0f / direction.y(), 1.0f / direction.z());
+
+            int stack[64];
+            int top = 0;
+            stack[top++] = 0;
+            while (top) {
+                const BVHNode& node = m_nodes[stack[--top]];
+                float t;
+                if (!node.Intersects(origin, inv, maxT, t)) continue;
+
+                if (node.IsLeaf()) {
+                    for (int i = 0; i < node.Count; i++) {
+                        visit(m_indices[node.LeftFirst + i], maxT);
+                    }
+                    continue;
+                }
+
+                // the box test is repeated on pop since maxT may have shrunk
+                int left  = node.LeftFirst;
+                int right = node.LeftFirst + 1;
+                float tLeft, tRight;
+                bool hitLeft  = m_nodes[left ].Intersects(origin, inv, maxT, tLeft);
+                bool hitRight = m_nodes[right].Intersects(origin, inv, maxT, tRight);
+                if (hitLeft && hitRight) {
+                    if (tRight < tLeft) std::swap(left, right);
+                    stack[top++] = right;
+                    stack[top++] = left;
+                }
+                else if (hitLeft) {
+                    stack[top++] = left;
+                }
+                else if (hitRight) {
+                    stack[top++] = right;
+                }
+            }
+        }
+    };
+
+}
+
+#endif // BVH_H
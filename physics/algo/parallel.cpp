@@ -0,0 +1,100 @@
+#include "parallel.h"
+
+#include <algorithm>
+
+namespace physE {
+
+    namespace {
+        // set on the pool's threads, and on a caller while it runs a range
+        thread_local bool t_inRange = false;
+    }
+
+    WorkerPool& WorkerPool::Global()
+    {
+        static WorkerPool pool(int(std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    WorkerPool::WorkerPool(int threads)
+    {
+        for (int i = 0; i < threads; i++) {
+            m_threads.emplace_back([this] { Work(); });
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::Run(int count, int grain, Task task, void* context)
+    {
+        if (m_threads.empty() || t_inRange || !m_run.try_lock()) {
+            task(context, 0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = task;
+            m_context = context;
+            m_count = count;
+            m_grain = grain;
+            m_next.store(0, std::memory_order_relaxed);
+            ++m_job;
+        }
+        m_wake.notify_all();
+
+        t_inRange = true;
+        TakeChunks(task, context, count, grain);
+        t_inRange = false;
+
+        {
+            // a worker that wakes after this sees no task and goes back to sleep
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_active == 0; });
+            m_task = nullptr;
+        }
+        m_run.unlock();
+    }
+
+    void WorkerPool::Work()
+    {
+        t_inRange = true;
+        quint64 seen = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_quit || m_job != seen; });
+            if (m_quit) return;
+            seen = m_job;
+            if (!m_task) continue;
+
+            const Task  task    = m_task;
+            void* const context = m_context;
+            const int   count   = m_count;
+            const int   grain   = m_grain;
+            ++m_active;
+            lock.unlock();
+            TakeChunks(task, context, count, grain);
+            lock.lock();
+            if (--m_active == 0) m_done.notify_all();
+        }
+    }
+
+    void WorkerPool::TakeChunks(Task task, void* context, int count, int grain)
+    {
+        for (;;) {
+            const int begin = m_next.fetch_add(grain, std::memory_order_relaxed);
+            if (begin >= count) return;
+            task(context, begin, std::min(begin + grain, count));
+        }
+    }
+
+}
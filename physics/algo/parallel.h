@@ -0,0 +1,80 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <QtGlobal>
+
+namespace physE {
+
+    /** @brief Worker threads kept for the whole run, so handing out a range
+     *  touches no heap: the job is a function pointer and a context pointer,
+     *  and the chunks are taken off one atomic counter. One range runs at a
+     *  time, a call from inside a running range or while another thread
+     *  owns the pool runs on the calling thread.
+     */
+    class WorkerPool
+    {
+    public:
+        using Task = void (*)(void* context, int begin, int end);
+
+        static WorkerPool& Global();
+
+        /** @brief Calls task(context, begin, end) for consecutive chunks of
+         *  [0, count) and returns once all of them are done. The calling
+         *  thread takes chunks too.
+         */
+        void Run(int count, int grain, Task task, void* context);
+
+    private:
+        explicit WorkerPool(int threads);
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator = (const WorkerPool&) = delete;
+        ~WorkerPool();
+
+        void Work();
+        void TakeChunks(Task task, void* context, int count, int grain);
+
+        std::vector<std::thread> m_threads;
+        std::mutex               m_run;     // held by the thread that owns the pool
+        std::mutex               m_mutex;   // guards the job below
+        std::condition_variable  m_wake;
+        std::condition_variable  m_done;
+
+        Task             m_task    = nullptr;
+        void*            m_context = nullptr;
+        int              m_count   = 0;
+        int              m_grain   = 1;
+        quint64          m_job     = 0;     // bumped for every range
+        int              m_active  = 0;     // workers inside the current range
+        bool             m_quit    = false;
+        std::atomic<int> m_next{0};
+    };
+
+    /** @brief Calls body(begin, end) for consecutive chunks of [0, count) on
+     *  the worker pool and returns once all of them are done. Ranges of at
+     *  most one chunk run on the calling thread.
+     *  @param[in] grain number of items per chunk
+     */
+    template<typename F>
+    void ParallelFor(int count, int grain, F&& body)
+    {
+        if (count <= 0) return;
+        if (count <= grain) {
+            body(0, count);
+            return;
+        }
+
+        using Body = typename std::remove_reference<F>::type;
+        WorkerPool::Global().Run(count, grain, [](void* context, int begin, int end) {
+            (*static_cast<Body*>(context))(begin, end);
+        }, const_cast<void*>(static_cast<const void*>(&body)));
+    }
+
+}
+
+#endif // PARALLEL_H
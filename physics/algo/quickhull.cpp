@@ -0,0 +1,371 @@
+#include "quickhull.h"
+
+#include <cmath>
+#include <cfloat>
+#include <unordered_map>
+
+namespace physE {
+
+    namespace {
+
+        struct Face
+        {
+            int V[3];
+            QVector3D Normal;
+            float Distance;
+            std::vector<int> Outside;
+            int   Furthest;
+            float FurthestDist;
+            int   Visited;
+            bool  Alive;
+        };
+
+        long long EdgeKey(int a, int b)
+        {
+            return (long long)a << 32 | (unsigned)b;
+        }
+
+        class Builder
+        {
+        public:
+            const std::vector<QVector3D>& P;
+            std::vector<Face> faces;
+            std::unordered_map<long long, int> edges; // directed edge -> face
+            float eps;
+
+            Builder(const std::vector<QVector3D>& points)
+                : P(points)
+            {
+                float m[3] = {0, 0, 0};
+                for (const QVector3D& p : P) {
+                    for (int k = 0; k < 3; k++) {
+                        m[k] = std::max(m[k], std::abs(p[k]));
+                    }
+                }
+                eps = 3 * FLT_EPSILON * (m[0] + m[1] + m[2]);
+            }
+
+            float Dist(const Face& f, int p) const
+            {
+                return QVector3D::dotProduct(f.Normal, P[p]) - f.Distance;
+            }
+
+            int AddFace(int a, int b, int c)
+            {
+                Face f;
+                f.V[0] = a;
+                f.V[1] = b;
+                f.V[2] = c;
+                f.Normal = QVector3D::normal(P[b] - P[a], P[c] - P[a]);
+                f.Distance = QVector3D::dotProduct(f.Normal, P[a]);
+                f.Furthest = -1;
+                f.FurthestDist = 0;
+                f.Visited = -1;
+                f.Alive = true;
+
+                int id = faces.size();
+                faces.push_back(std::move(f));
+                edges[EdgeKey(a, b)] = id;
+                edges[EdgeKey(b, c)] = id;
+                edges[EdgeKey(c, a)] = id;
+                return id;
+            }
+
+            void RemoveFace(int id)
+            {
+                Face& f = faces[id];
+                edges.erase(EdgeKey(f.V[0], f.V[1]));
+                edges.erase(EdgeKey(f.V[1], f.V[2]));
+                edges.erase(EdgeKey(f.V[2], f.V[0]));
+                f.Alive = false;
+                f.Outside.clear();
+                f.Outside.shrink_to_fit();
+            }
+
+            int Twin(int a, int b) const
+            {
+                auto it = edges.find(EdgeKey(b, a));
+                return it == edges.end() ? -1 : it->second;
+            }
+
+            // Hands p to the first new face it is in front of, drops it otherwise
+            void Assign(int p, const std::vector<int>& candidates)
+            {
+                for (int id : candidates) {
+                    Face& f = faces[id];
+                    float d = Dist(f, p);
+                    if (d > eps) {
+                        f.Outside.push_back(p);
+                        if (d > f.FurthestDist) {
+                            f.FurthestDist = d;
+                            f.Furthest = p;
+                        }
+                        return;
+                    }
+                }
+            }
+
+            bool InitialSimplex(int tetra[4])
+            {
+                int extreme[6] = {0, 0, 0, 0, 0, 0};
+                for (int i = 1; i < (int)P.size(); i++) {
+                    for (int k = 0; k < 3; k++) {
+                        if (P[i][k] < P[extreme[2 * k]][k])     extreme[2 * k]     = i;
+                        if (P[i][k] > P[extreme[2 * k + 1]][k]) extreme[2 * k + 1] = i;
+                    }
+                }
+
+                float best = -1;
+                for (int k = 0; k < 3; k++) {
+                    float d = (P[extreme[2 * k + 1]] - P[extreme[2 * k]]).lengthSquared();
+                    if (d > best) {
+                        best = d;
+                        tetra[0] = extreme[2 * k];
+                        tetra[1] = extreme[2 * k + 1];
+                    }
+                }
+                if (best <= eps * eps) return false;
+
+                QVector3D axis = (P[tetra[1]] - P[tetra[0]]).normalized();
+                best = -1;
+                for (int i = 0; i < (int)P.size(); i++) {
+                    QVector3D d = P[i] - P[tetra[0]];
+                    float dist = (d - QVector3D::dotProduct(d, axis) * axis).lengthSquared();
+                    if (dist > best) {
+                        best = dist;
+                        tetra[2] = i;
+                    }
+                }
+                if (best <= eps * eps) return false;
+
+                QVector3D n = QVector3D::normal(P[tetra[1]] - P[tetra[0]], P[tetra[2]] - P[tetra[0]]);
+                best = -1;
+                for (int i = 0; i < (int)P.size(); i++) {
+                    float dist = std::abs(QVector3D::dotProduct(n, P[i] - P[tetra[0]]));
+                    if (dist > best) {
+                        best = dist;
+                        tetra[3] = i;
+                    }
+                }
+                if (best <= eps) return false;
+
+                // make the base face look away from the apex
+                if (QVector3D::dotProduct(n, P[tetra[3]] - P[tetra[0]]) > 0) {
+                    std::swap(tetra[1], tetra[2]);
+                }
+                return true;
+            }
+
+            bool Build(int maxVertices)
+            {
+                int t[4];
+                if (P.size() < 4 || !InitialSimplex(t)) return false;
+
+                std::vector<int> created{
+                    AddFace(t[0], t[1], t[2]),
+                    AddFace(t[0], t[3], t[1]),
+                    AddFace(t[1], t[3], t[2]),
+                    AddFace(t[2], t[3], t[0])
+                };
+                for (int i = 0; i < (int)P.size(); i++) {
+                    if (i == t[0] || i == t[1] || i == t[2] || i == t[3]) continue;
+                    Assign(i, created);
+                }
+
+                int vertexCount = 4;
+                std::vector<int> pending(created);
+                std::vector<int> visible;
+                std::vector<int> stack;
+                std::vector<std::pair<int, int>> horizon;
+                std::vector<int> orphans;
+
+                for (int iteration = 0; ; iteration++) {
+                    if (maxVertices > 0 && vertexCount >= maxVertices) break;
+
+                    // with a vertex budget always take the globally furthest
+                    // point, otherwise any face with outside points will do
+                    int eyeFace = -1;
+                    if (maxVertices > 0) {
+                        float best = 0;
+                        for (int id = 0; id < (int)faces.size(); id++) {
+                            if (faces[id].Alive && faces[id].FurthestDist > best) {
+                                best = faces[id].FurthestDist;
+                                eyeFace = id;
+                            }
+                        }
+                    }
+                    else {
+                        while (!pending.empty() && eyeFace < 0) {
+                            int id = pending.back();
+                            pending.pop_back();
+                            if (faces[id].Alive && !faces[id].Outside.empty()) eyeFace = id;
+                        }
+                    }
+                    if (eyeFace < 0) break;
+
+                    const int eye = faces[eyeFace].Furthest;
+
+                    // flood the faces the eye can see and collect the horizon
+                    visible.clear();
+                    horizon.clear();
+                    stack.assign(1, eyeFace);
+                    faces[eyeFace].Visited = iteration;
+                    while (!stack.empty()) {
+                        int id = stack.back();
+                        stack.pop_back();
+                        visible.push_back(id);
+
+                        for (int e = 0; e < 3; e++) {
+                            int a = faces[id].V[e];
+                            int b = faces[id].V[(e + 1) % 3];
+                            int twin = Twin(a, b);
+                            if (twin < 0) continue;
+                            if (faces[twin].Visited == iteration) continue;
+
+                            if (Dist(faces[twin], eye) > eps) {
+                                faces[twin].Visited = iteration;
+                                stack.push_back(twin);
+                            }
+                            else {
+                                horizon.emplace_back(a, b);
+                            }
+                        }
+                    }
+
+                    orphans.clear();
+                    for (int id : visible) {
+                        for (int p : faces[id].Outside) {
+                            if (p != eye) orphans.push_back(p);
+                        }
+                        RemoveFace(id);
+                    }
+
+                    created.clear();
+                    for (const std::pair<int, int>& e : horizon) {
+                        created.push_back(AddFace(e.first, e.second, eye));
+                    }
+                    for (int p : orphans) {
+                        Assign(p, created);
+                    }
+                    pending.insert(pending.end(), created.begin(), created.end());
+                    vertexCount++;
+                }
+                return true;
+            }
+
+            void Output(ConvexHullData& hull, float mergeAngle)
+            {
+                // Grow polygons from seed triangles over neighbours that are
+                // nearly coplanar with the seed itself, not just with each
+                // other, so a finely tessellated curve never merges into one face.
+                const float cosMerge = std::cos(mergeAngle);
+                const float planeTol = 100 * eps;
+                std::vector<int> group(faces.size(), -1);
+                std::vector<std::vector<int>> groups;
+                std::vector<int> stack;
+                for (int seed = 0; seed < (int)faces.size(); seed++) {
+                    if (!faces[seed].Alive || group[seed] >= 0) continue;
+
+                    const int g = groups.size();
+                    groups.emplace_back();
+                    group[seed] = g;
+                    stack.assign(1, seed);
+                    while (!stack.empty()) {
+                        int id = stack.back();
+                        stack.pop_back();
+                        groups[g].push_back(id);
+
+                        for (int e = 0; e < 3; e++) {
+                            int twin = Twin(faces[id].V[e], faces[id].V[(e + 1) % 3]);
+                            if (twin < 0 || group[twin] >= 0) continue;
+
+                            const Face& f = faces[twin];
+                            if (QVector3D::dotProduct(f.Normal, faces[seed].Normal) < cosMerge) continue;
+                            if (std::abs(Dist(faces[seed], f.V[0])) > planeTol
+                             || std::abs(Dist(faces[seed], f.V[1])) > planeTol
+                             || std::abs(Dist(faces[seed], f.V[2])) > planeTol) continue;
+
+                            group[twin] = g;
+                            stack.push_back(twin);
+                        }
+                    }
+                }
+
+                std::vector<int> remap(P.size(), -1);
+                auto vertex = [&](int p) {
+                    if (remap[p] < 0) {
+                        remap[p] = hull.Vertices.size();
+                        hull.Vertices.push_back(P[p]);
+                    }
+                    return remap[p];
+                };
+
+                std::unordered_map<int, int> next;
+                std::vector<int> loop;
+                for (int g = 0; g < (int)groups.size(); g++) {
+                    // the boundary edges of the group chain into one loop
+                    next.clear();
+                    QVector3D normal;
+                    for (int id : groups[g]) {
+                        const Face& f = faces[id];
+                        normal += QVector3D::crossProduct(P[f.V[1]] - P[f.V[0]], P[f.V[2]] - P[f.V[0]]);
+                        for (int e = 0; e < 3; e++) {
+                            int a = f.V[e];
+                            int b = f.V[(e + 1) % 3];
+                            int twin = Twin(a, b);
+                            if (twin < 0 || group[twin] != g) next[a] = b;
+                        }
+                    }
+
+                    loop.clear();
+                    int start = next.begin()->first;
+                    int v = start;
+                    do {
+                        loop.push_back(v);
+                        v = next[v];
+                    } while (v != start && loop.size() <= next.size());
+
+                    // the plane is pushed out to the furthest triangle corner
+                    // so every merged away vertex stays behind it
+                    HullFace face;
+                    face.Normal = normal.normalized();
+                    face.Distance = -FLT_MAX;
+                    face.First = hull.FaceVertices.size();
+                    face.Count = loop.size();
+                    for (int id : groups[g]) {
+                        for (int k = 0; k < 3; k++) {
+                            face.Distance = std::max(face.Distance, QVector3D::dotProduct(face.Normal, P[faces[id].V[k]]));
+                        }
+                    }
+                    for (int p : loop) {
+                        hull.FaceVertices.push_back(vertex(p));
+                    }
+                    hull.Faces.push_back(face);
+
+                    for (int k = 1; k + 1 < (int)loop.size(); k++) {
+                        hull.Index.push_back(remap[loop[0]]);
+                        hull.Index.push_back(remap[loop[k]]);
+                        hull.Index.push_back(remap[loop[k + 1]]);
+                    }
+                }
+            }
+        };
+    }
+
+    bool QuickHull(
+        const std::vector<QVector3D>& points,
+        ConvexHullData& hull,
+        int maxVertices,
+        float mergeAngle)
+    {
+        hull = ConvexHullData();
+
+        Builder builder(points);
+        if (!builder.Build(std::max(maxVertices, maxVertices > 0 ? 4 : 0))) {
+            return false;
+        }
+        builder.Output(hull, mergeAngle);
+        return true;
+    }
+
+}
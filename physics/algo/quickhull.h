@@ -0,0 +1,50 @@
+#ifndef QUICKHULL_H
+#define QUICKHULL_H
+
+#include <vector>
+#include <QVector3D>
+
+namespace physE {
+
+    /** @brief Planar polygon of a hull, the points of Normal . x == Distance.
+     *  Its vertex loop is FaceVertices[First, First + Count), counter
+     *  clockwise seen from outside.
+     */
+    struct HullFace
+    {
+        QVector3D Normal;
+        float     Distance;
+        int       First;
+        int       Count;
+    };
+
+    /** @brief Output of QuickHull. Index triangulates the faces, wound so the
+     *  right hand normal points out.
+     */
+    struct ConvexHullData
+    {
+        std::vector<QVector3D> Vertices;
+        std::vector<int>       Index;
+        std::vector<HullFace>  Faces;
+        std::vector<int>       FaceVertices;
+    };
+
+    /** @brief Computes the convex hull of a point set.
+     *  @param[in] points the input points, duplicates and interior points are fine
+     *  @param[out] hull the hull, only the vertices that are used are kept
+     *  @param[in] maxVertices stop once the hull has this many vertices, 0 for the exact hull.
+     *  Points are added furthest first, so a truncated hull is the best inner
+     *  approximation the iteration can give.
+     *  @param[in] mergeAngle adjacent triangles whose normals differ by less
+     *  than this (radians) are merged into one polygon face
+     *  @return false if the points are degenerate (fewer than 4 or flat)
+     */
+    bool QuickHull(
+        const std::vector<QVector3D>& points,
+        ConvexHullData& hull,
+        int maxVertices = 0,
+        float mergeAngle = 0.01f);
+
+}
+
+#endif // QUICKHULL_H
@@ -0,0 +1,51 @@
+#include "spatialhash.h"
+#include "parallel.h"
+
+namespace physE {
+
+    void SpatialHash::Build(const QVector3D* points, int count, float spacing)
+    {
+        m_points = points;
+        m_invSpacing = 1.0f / spacing;
+
+        const size_t size = 2 * size_t(count) + 1;
+        m_cells.resize(size + 1);
+        m_indices.resize(count);
+        m_entry.resize(count);
+        if (m_countsSize < size) {
+            m_counts.reset(new std::atomic<int>[size]);
+            m_countsSize = size;
+        }
+        for (size_t h = 0; h < size; h++) {
+            m_counts[h].store(0, std::memory_order_relaxed);
+        }
+
+        // entry of every point and how many land in each
+        ParallelFor(count, 4096, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                const QVector3D& p = points[i];
+                m_entry[i] = Hash(Coord(p.x()), Coord(p.y()), Coord(p.z()));
+                m_counts[m_entry[i]].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        // m_counts becomes the end of every entry, filling counts it back
+        // down to the start
+        int sum = 0;
+        for (size_t h = 0; h < size; h++) {
+            sum += m_counts[h].load(std::memory_order_relaxed);
+            m_counts[h].store(sum, std::memory_order_relaxed);
+        }
+        ParallelFor(count, 4096, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                m_indices[m_counts[m_entry[i]].fetch_sub(1, std::memory_order_relaxed) - 1] = i;
+            }
+        });
+
+        for (size_t h = 0; h < size; h++) {
+            m_cells[h] = m_counts[h].load(std::memory_order_relaxed);
+        }
+        m_cells[size] = count;
+    }
+
+}
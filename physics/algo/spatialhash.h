@@ -0,0 +1,114 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <QVector3D>
+#include "aabb.h"
+
+namespace physE {
+
+    /** @brief Uniform grid over a point set, hashed into a table twice the
+     *  size of the set. Points are stored grouped by table entry, so a
+     *  query only walks the entries of the cells it overlaps.
+     */
+    class SpatialHash
+    {
+    public:
+        /** @brief Sorts the points into cells of the given size, in parallel.
+         *  @param[in] spacing cell size, queries are fastest when their
+         *  radius is about one cell
+         */
+        void Build(const QVector3D* points, int count, float spacing);
+
+        /** @brief Calls visit(index) for every point within radius of the
+         *  query point.
+         */
+        template<typename F>
+        void Query(const QVector3D& p, float radius, F&& visit) const
+        {
+            if (m_cells.empty()) return;
+
+            const int x0 = Coord(p.x() - radius), x1 = Coord(p.x() + radius);
+            const int y0 = Coord(p.y() - radius), y1 = Coord(p.y() + radius);
+            const int z0 = Coord(p.z() - radius), z1 = Coord(p.z() + radius);
+            const float r2 = radius * radius;
+            for (int x = x0; x <= x1; x++) {
+                for (int y = y0; y <= y1; y++) {
+                    for (int z = z0; z <= z1; z++) {
+                        const int h = Hash(x, y, z);
+                        for (int k = m_cells[h]; k < m_cells[h + 1]; k++) {
+                            const int i = m_indices[k];
+                            if ((m_points[i] - p).lengthSquared() <= r2) visit(i);
+                        }
+                    }
+                }
+            }
+        }
+
+        /** @brief Calls visit(index) once for every point inside the box.
+         *  Boxes covering more cells than there are points just test every
+         *  point.
+         */
+        template<typename F>
+        void QueryBox(const AABB& box, F&& visit) const
+        {
+            if (m_cells.empty() || box.IsEmpty()) return;
+
+            const int count = int(m_entry.size());
+            const double cells = (double(Coord(box.Max.x())) - Coord(box.Min.x()) + 1)
+                               * (double(Coord(box.Max.y())) - Coord(box.Min.y()) + 1)
+                               * (double(Coord(box.Max.z())) - Coord(box.Min.z()) + 1);
+            if (cells > count) {
+                for (int i = 0; i < count; i++) {
+                    if (box.Contains(m_points[i])) visit(i);
+                }
+                return;
+            }
+
+            const int x0 = Coord(box.Min.x()), x1 = Coord(box.Max.x());
+            const int y0 = Coord(box.Min.y()), y1 = Coord(box.Max.y());
+            const int z0 = Coord(box.Min.z()), z1 = Coord(box.Max.z());
+            for (int x = x0; x <= x1; x++) {
+                for (int y = y0; y <= y1; y++) {
+                    for (int z = z0; z <= z1; z++) {
+                        const int h = Hash(x, y, z);
+                        for (int k = m_cells[h]; k < m_cells[h + 1]; k++) {
+                            const int i = m_indices[k];
+                            const QVector3D& p = m_points[i];
+                            // other cells of the box may share the entry,
+                            // only the point's own cell reports it
+                            if (Coord(p.x()) == x && Coord(p.y()) == y && Coord(p.z()) == z
+                                && box.Contains(p)) visit(i);
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        int Coord(float v) const
+        {
+            return int(std::floor(v * m_invSpacing));
+        }
+
+        int Hash(int x, int y, int z) const
+        {
+            const unsigned h = unsigned(x) * 92837111u ^ unsigned(y) * 689287499u ^ unsigned(z) * 283923481u;
+            return int(h % unsigned(m_cells.size() - 1));
+        }
+
+        const QVector3D*  m_points     = nullptr;
+        float             m_invSpacing = 1;
+        std::vector<int>  m_cells;   //!< first index of every entry, one past the end last
+        std::vector<int>  m_indices; //!< point indices grouped by entry
+        std::vector<int>  m_entry;   //!< entry of every point
+        std::unique_ptr<std::atomic<int>[]> m_counts;
+        size_t            m_countsSize = 0;
+    };
+
+}
+
+#endif // SPATIALHASH_H
@@ -1,12 +1,13 @@
 #include "physicalworld.h"
 #include "Collision/DetectCollisoin.h"
+#include "algo/parallel.h"
 
 namespace physE {
 
     void physicalworld::buildKDtree()
     {
         QVector<QVector3D> res;
-        for (Object* a : qAsConst(m_objects))
+        for (Object* a : m_objects.Objects())
         {
             res.push_back(a->Transform->Position);
         }
@@ -15,81 +16,389 @@ namespace physE {
 
     void physicalworld::ResolveCollisions(float dt)
     {
-        std::vector<Collision> collisions;
-        for (Object* a : qAsConst(m_objects)) {
-        //for (int i = 0; i < m_objects.size(); i++) {
-            //Object* a = m_objects.at(i);
-            //QVector<int> kindices;
-            //QVector<float> k_distance_indices;
-            //buildKDtree();
-            //int num = tree.RadiusSearch(a->Transform->Position, 2, kindices, k_distance_indices);
-            //if(num > 1)
-            {
-                //for (auto&i:kindices) {
-                //for (int j = 0; j < m_objects.size(); j++) {
-                    //Object* b = m_objects.at(j);
-                for (Object* b : qAsConst(m_objects)) {
-                    if (a == b) continue;
-
-                    if (    !a->Collider
-                        || !b->Collider)
-                    {
-                        continue;
-                    }
-
-                    CollisionPoints points = impl::DetectCollision(
-                        a->Collider,
-                        a->Transform,
-                        b->Collider,
-                        b->Transform);
-
-                    if (points.HasCollision==true) {
-                        //qDebug()<<a->Position<<" "<<b->Position;
-                        collisions.emplace_back(a, b, points);
-                    }
-                }
+        FrameVector<impl::CollisionPair> pairs;
+        m_broadphase.FindPairs(m_objects.Objects(), pairs);
+
+        // trigger pairs only record the overlap and never reach the solver
+        auto triggers = std::partition(pairs.begin(), pairs.end(), [](const impl::CollisionPair& pair) {
+            return !pair.A->IsTrigger && !pair.B->IsTrigger;
+        });
+        for (auto it = triggers; it != pairs.end(); ++it) {
+            Object* trigger = it->A->IsTrigger ? it->A : it->B;
+            Object* other   = it->A->IsTrigger ? it->B : it->A;
+            if (other->IsTrigger) continue;
+
+            if (impl::TestOverlap(trigger->Collider, trigger->Transform, other->Collider, other->Transform)) {
+                m_triggerOverlaps.emplace_back(trigger, other);
             }
         }
+        pairs.erase(triggers, pairs.end());
+
+        FrameVector<Collision> collisions;
+        impl::DetectCollisions(pairs, collisions);
+
+        for (Solver* solver : m_solvers) {
+            solver->Solve(collisions, dt);
+        }
+    }
+
+    // Contact planes for the cloth's next update, against every collider
+    // within reach. Bodies are culled by the box around the cloth, particles
+    // by the cells under each remaining body, so a cloth far from
+    // everything only costs one pass over its particles. Every candidate is
+    // a sphere against the body's collider through the regular narrow
+    // phase, grown by one link length so contacts are there before the
+    // particle gets to the surface.
+    void physicalworld::CollideCloth()
+    {
+        struct Candidate
+        {
+            int Particle;
+            Object* Obj;
+            CollisionPoints Points;
+        };
+
+        cloth.contacts.clear();
+        m_clothContactBodies.clear();
 
-        for (Object* a : qAsConst(m_objects)) {
-            CollisionPoints points = impl::DetectCollision(
-                a->Collider,
-                a->Transform,
-                planeobject->Collider,
-                planeobject->Transform);
+        ParticleStore& particles = cloth.particles;
+        const int count = particles.size();
+        if (count == 0 || cloth.collision_radius <= 0) return;
+        const float reach = cloth.collision_radius + cloth.links_length;
 
-            if (points.HasCollision==true) {
-                //qDebug()<<a->Position<<" "<<planeobject->Position;
-                collisions.emplace_back(a, planeobject, points);
+        AABB bounds;
+        for (const QVector3D& p : particles.position) {
+            bounds.Expand(p);
+        }
+        bounds = bounds.Inflated(reach);
+
+        FrameVector<Object*> bodies;
+        for (Object* obj : m_objects.Objects()) {
+            if (obj->IsTrigger || !obj->Collider) continue;
+            if (!obj->Collider->GetAABB(obj->Transform).Overlaps(bounds)) continue;
+            if (obj->Collider->get_type() == (size_t)ColliderType::PLANE) {
+                // unbounded, keep it only when the box reaches behind it
+                const impl::PlaneCollider* plane = (const impl::PlaneCollider*)obj->Collider;
+                const QVector3D normal = plane->Normal.normalized();
+                const QVector3D half = bounds.Extent() * 0.5f;
+                const float extent = std::abs(normal.x()) * half.x() + std::abs(normal.y()) * half.y()
+                                   + std::abs(normal.z()) * half.z();
+                const QVector3D onPlane = normal * plane->Distance + obj->Transform->Position;
+                if (QVector3D::dotProduct(bounds.Center() - onPlane, normal) > extent) continue;
             }
+            bodies.push_back(obj);
         }
+        if (bodies.empty()) return;
 
-        std::sort(collisions.begin(), collisions.end(), [&](Collision lhs, Collision rhs){
-            if(lhs.ObjA < rhs.ObjA) return true;
+        m_clothCells.Build(particles.position.data(), count, cloth.links_length);
+        FrameVector<Candidate> candidates;
+        for (Object* obj : bodies) {
+            AABB box = obj->Collider->GetAABB(obj->Transform).Inflated(reach).Intersection(bounds);
+            m_clothCells.QueryBox(box, [&](int i) {
+                if (particles.moving(i)) candidates.push_back({i, obj, CollisionPoints()});
+            });
+        }
 
-            if(lhs.ObjA == rhs.ObjA)
-                return lhs.ObjB < rhs.ObjB;
-            return false;
+        ParallelFor(candidates.size(), 64, [&](int begin, int end) {
+            impl::SphereCollider sphere(QVector3D(), reach);
+            Transform at;
+            at.Scale = QVector3D(1, 1, 1);
+            for (int k = begin; k < end; k++) {
+                Candidate& c = candidates[k];
+                at.Position = particles.position[c.Particle];
+                c.Points = impl::DetectCollision(&sphere, &at, c.Obj->Collider, c.Obj->Transform);
+            }
         });
-        std::vector<Collision> uniqueCollisions;
-
-            int i = 0;
-            while(i < collisions.size())
-            {
-                Collision col = collisions[i];
-                uniqueCollisions.push_back(col);
-                i++;
-                while(i < collisions.size())
-                {
-                    Collision poC = collisions[i];
-                    if(col.ObjA != poC.ObjB || col.ObjB != poC.ObjA) break;
-                    i++;
-                }
+
+        // the plane touches the body where the sphere reached deepest. The
+        // points themselves are not used, EPA leaves them out when the
+        // particle is already inside
+        for (const Candidate& c : candidates) {
+            if (!c.Points.HasCollision) continue;
+            Object* obj = c.Obj;
+            const bool moves = obj->IsDynamic || obj->IsKinematic;
+            ClothContact contact;
+            contact.particle = c.Particle;
+            contact.point    = particles.position[c.Particle] + c.Points.Normal * (reach - c.Points.Depth);
+            contact.normal   = -c.Points.Normal;
+            const QVector3D r = contact.point - obj->WorldCenterOfMass();
+            contact.velocity = moves ? obj->Velocity + QVector3D::crossProduct(obj->angularVelocity, r)
+                                     : QVector3D();
+            contact.inv_mass = 0;
+            if (m_clothTwoWay && obj->IsDynamic) {
+                const QVector3D rn = QVector3D::crossProduct(r, contact.normal);
+                contact.inv_mass = 1.0f / obj->Mass + QVector3D::dotProduct(rn, obj->InvInertiaWorld.mapVector(rn));
             }
+            cloth.contacts.push_back(contact);
+            m_clothContactBodies.push_back(obj);
+        }
 
+        // candidates come body by body, contacts of one body share its mass
+        for (size_t begin = 0, end; begin < cloth.contacts.size(); begin = end) {
+            for (end = begin + 1; end < cloth.contacts.size(); end++) {
+                if (m_clothContactBodies[end] != m_clothContactBodies[begin]) break;
+            }
+            for (size_t k = begin; k < end; k++) {
+                cloth.contacts[k].inv_mass /= float(end - begin);
+            }
+        }
+    }
 
-        for (Solver* solver : m_solvers) {
-            solver->Solve(uniqueCollisions, dt);
+    // Two way coupling: dynamic bodies move back as far as their contact
+    // planes did and take the opposite of the momentum their contacts gave
+    // the cloth during the update, at the contact
+    void physicalworld::PushBodiesFromCloth()
+    {
+        if (!m_clothTwoWay) return;
+
+        for (size_t k = 0; k < cloth.contacts.size(); k++) {
+            const ClothContact& c = cloth.contacts[k];
+            Object* obj = m_clothContactBodies[k];
+            if (!obj->IsDynamic || c.impulse.isNull()) continue;
+            obj->Transform->Position += c.offset;
+
+            // the links keep pulling a particle back into the contact plane,
+            // so the summed pushes can hold more than the body brings in.
+            // Hand over at most what stops the body against the particle.
+            const QVector3D r = c.point - obj->WorldCenterOfMass();
+            const QVector3D rn = QVector3D::crossProduct(r, c.normal);
+            const float inv_mass = 1.0f / obj->Mass + QVector3D::dotProduct(rn, obj->InvInertiaWorld.mapVector(rn));
+            const QVector3D body = obj->Velocity + QVector3D::crossProduct(obj->angularVelocity, r);
+            const float closing = QVector3D::dotProduct(body, c.normal);
+            const float push = QVector3D::dotProduct(c.impulse, c.normal);
+            if (closing <= 0.0f || push <= 0.0f) continue;
+
+            const QVector3D impulse = c.impulse * std::min(1.0f, closing / (inv_mass * push));
+            obj->Velocity -= impulse / obj->Mass;
+            obj->angularVelocity -= obj->InvInertiaWorld.mapVector(QVector3D::crossProduct(r, impulse));
+        }
+    }
+
+    void physicalworld::UpdateTriggerEvents()
+    {
+        // substeps may report the same overlap more than once
+        std::sort(m_triggerOverlaps.begin(), m_triggerOverlaps.end());
+        m_triggerOverlaps.erase(std::unique(m_triggerOverlaps.begin(), m_triggerOverlaps.end()), m_triggerOverlaps.end());
+
+        // both lists are sorted, one merge pass finds begin, stay and end
+        m_triggerEvents.clear();
+        auto cur  = m_triggerOverlaps.begin();
+        auto prev = m_prevTriggerOverlaps.begin();
+        while (cur != m_triggerOverlaps.end() || prev != m_prevTriggerOverlaps.end()) {
+            if (prev == m_prevTriggerOverlaps.end() || (cur != m_triggerOverlaps.end() && *cur < *prev)) {
+                m_triggerEvents.push_back({TriggerEvent::Begin, cur->first, cur->second});
+                ++cur;
+            }
+            else if (cur == m_triggerOverlaps.end() || *prev < *cur) {
+                m_triggerEvents.push_back({TriggerEvent::End, prev->first, prev->second});
+                ++prev;
+            }
+            else {
+                m_triggerEvents.push_back({TriggerEvent::Stay, cur->first, cur->second});
+                ++cur;
+                ++prev;
+            }
+        }
+
+        m_prevTriggerOverlaps.swap(m_triggerOverlaps);
+    }
+
+    void physicalworld::FlushRemoved()
+    {
+        if (m_objects.Pending().empty()) return;
+
+        // nothing may keep pointing at the objects once they are destroyed
+        std::vector<Object*> removed = m_objects.Pending();
+        std::sort(removed.begin(), removed.end());
+        auto isRemoved = [&](Object* obj) {
+            return std::binary_search(removed.begin(), removed.end(), obj);
+        };
+        auto overlapRemoved = [&](const std::pair<Object*, Object*>& overlap) {
+            return isRemoved(overlap.first) || isRemoved(overlap.second);
+        };
+        m_triggerOverlaps.erase(std::remove_if(m_triggerOverlaps.begin(), m_triggerOverlaps.end(), overlapRemoved), m_triggerOverlaps.end());
+        m_prevTriggerOverlaps.erase(std::remove_if(m_prevTriggerOverlaps.begin(), m_prevTriggerOverlaps.end(), overlapRemoved), m_prevTriggerOverlaps.end());
+        m_triggerEvents.erase(std::remove_if(m_triggerEvents.begin(), m_triggerEvents.end(), [&](const TriggerEvent& event) {
+            return isRemoved(event.Trigger) || isRemoved(event.Other);
+        }), m_triggerEvents.end());
+
+        // a new object may land on a freed address, so the static tree
+        // cannot rely on comparing pointers any more
+        for (Object* obj : removed) {
+            if (!obj->IsDynamic) {
+                m_broadphase.InvalidateStatic();
+                break;
+            }
+        }
+        if (planeobject && isRemoved(planeobject)) {
+            planeobject = nullptr;
+        }
+
+        m_broadphase.InvalidateQueries();
+        m_objects.Flush();
+    }
+
+    namespace {
+
+        // Closest hit of caster against the candidates in the broadphase.
+        // Plain rays walk the trees front to back, shapes query their swept box.
+        template<typename Caster>
+        bool CastClosest(
+            const impl::Broadphase& broadphase,
+            const Caster* caster, Transform* ct, bool isRay,
+            const QVector3D& origin, const QVector3D& direction, float maxDistance,
+            RaycastHit& hit, const QueryFilter& filter)
+        {
+            hit = RaycastHit();
+            auto visit = [&](Object* obj, float& maxT) {
+                if (!filter.Accepts(obj)) return;
+
+                float t;
+                QVector3D normal, point;
+                if (impl::CastCollider(caster, ct, direction, maxT, obj->Collider, obj->Transform, t, normal, point)) {
+                    maxT = t;
+                    hit.Obj = obj;
+                    hit.Distance = t;
+                    hit.Normal = normal;
+                    hit.Point = point;
+                }
+            };
+
+            if (isRay) {
+                broadphase.QueryRay(origin, direction, maxDistance, visit);
+            }
+            else {
+                float maxT = maxDistance;
+                broadphase.QueryBox(impl::SweptBounds(caster, ct, direction, maxDistance), [&](Object* obj) {
+                    visit(obj, maxT);
+                });
+            }
+            return hit.Obj != nullptr;
         }
+
+        bool Normalize(const QVector3D& direction, QVector3D& unit)
+        {
+            float length = direction.length();
+            if (length <= 0) return false;
+            unit = direction / length;
+            return true;
+        }
+    }
+
+    bool physicalworld::Raycast(
+        const QVector3D& origin, const QVector3D& direction, float maxDistance,
+        RaycastHit& hit, const QueryFilter& filter)
+    {
+        QVector3D dir;
+        if (!Normalize(direction, dir)) return false;
+        m_broadphase.PrepareQueries(m_objects.Objects());
+
+        impl::PointShape point{origin};
+        return CastClosest(m_broadphase, &point, nullptr, true, origin, dir, maxDistance, hit, filter);
+    }
+
+    bool physicalworld::RaycastAny(
+        const QVector3D& origin, const QVector3D& direction, float maxDistance,
+        const QueryFilter& filter)
+    {
+        QVector3D dir;
+        if (!Normalize(direction, dir)) return false;
+        m_broadphase.PrepareQueries(m_objects.Objects());
+
+        impl::PointShape point{origin};
+        bool found = false;
+        m_broadphase.QueryRay(origin, dir, maxDistance, [&](Object* obj, float& maxT) {
+            if (found || !filter.Accepts(obj)) return;
+
+            float t;
+            QVector3D normal, p;
+            if (impl::CastCollider(&point, nullptr, dir, maxT, obj->Collider, obj->Transform, t, normal, p)) {
+                found = true;
+                maxT = -1; // ends the traversal
+            }
+        });
+        return found;
+    }
+
+    int physicalworld::RaycastAll(
+        const QVector3D& origin, const QVector3D& direction, float maxDistance,
+        std::vector<RaycastHit>& hits, const QueryFilter& filter)
+    {
+        hits.clear();
+        QVector3D dir;
+        if (!Normalize(direction, dir)) return 0;
+        m_broadphase.PrepareQueries(m_objects.Objects());
+
+        impl::PointShape point{origin};
+        m_broadphase.QueryRay(origin, dir, maxDistance, [&](Object* obj, float& maxT) {
+            if (!filter.Accepts(obj)) return;
+
+            RaycastHit hit;
+            if (impl::CastCollider(&point, nullptr, dir, maxT, obj->Collider, obj->Transform,
+                                   hit.Distance, hit.Normal, hit.Point)) {
+                hit.Obj = obj;
+                hits.push_back(hit);
+            }
+        });
+        std::sort(hits.begin(), hits.end(), [](const RaycastHit& a, const RaycastHit& b) {
+            return a.Distance < b.Distance;
+        });
+        return hits.size();
+    }
+
+    bool physicalworld::SphereCast(
+        const QVector3D& center, float radius, const QVector3D& direction, float maxDistance,
+        RaycastHit& hit, const QueryFilter& filter)
+    {
+        QVector3D dir;
+        if (!Normalize(direction, dir)) return false;
+        m_broadphase.PrepareQueries(m_objects.Objects());
+
+        impl::SphereShape sphere{center, radius};
+        return CastClosest(m_broadphase, &sphere, nullptr, false, center, dir, maxDistance, hit, filter);
+    }
+
+    bool physicalworld::ShapeCast(
+        const Collider* shape, Transform* transform, const QVector3D& direction, float maxDistance,
+        RaycastHit& hit, const QueryFilter& filter)
+    {
+        QVector3D dir;
+        if (!Normalize(direction, dir)) return false;
+        m_broadphase.PrepareQueries(m_objects.Objects());
+
+        return CastClosest(m_broadphase, shape, transform, false, transform->Position, dir, maxDistance, hit, filter);
+    }
+
+    int physicalworld::OverlapAABB(const AABB& box, std::vector<Object*>& objects, const QueryFilter& filter)
+    {
+        objects.clear();
+        m_broadphase.PrepareQueries(m_objects.Objects());
+
+        m_broadphase.QueryBox(box, [&](Object* obj) {
+            if (filter.Accepts(obj) && obj->Collider->GetAABB(obj->Transform).Overlaps(box)) {
+                objects.push_back(obj);
+            }
+        });
+        return objects.size();
+    }
+
+    void physicalworld::RaycastBatch(
+        const std::vector<Ray>& rays, std::vector<RaycastHit>& hits,
+        const QueryFilter& filter)
+    {
+        hits.assign(rays.size(), RaycastHit());
+        // after this the broadphase is only read
+        m_broadphase.PrepareQueries(m_objects.Objects());
+
+        const impl::Broadphase& broadphase = m_broadphase;
+        ParallelFor(rays.size(), 256, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                QVector3D dir;
+                if (!Normalize(rays[i].Direction, dir)) continue;
+
+                impl::PointShape point{rays[i].Origin};
+                CastClosest(broadphase, &point, nullptr, true, rays[i].Origin, dir, rays[i].MaxDistance, hits[i], filter);
+            }
+        });
     }
 }
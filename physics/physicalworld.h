@@ -6,9 +6,17 @@
 #include "Collision/SphereCollider.h"
 #include "Collision/PlaneCollider.h"
 #include "Collision/HullCollider.h"
+#include "Collision/CapsuleCollider.h"
+#include "Collision/MeshCollider.h"
+#include "Collision/HeightfieldCollider.h"
+#include "Collision/CompoundCollider.h"
+#include "Collision/Broadphase.h"
+#include "Collision/ObjectPool.h"
+#include "Collision/Query.h"
 
 #include "Dynamic/ImpluseSolveer.h"
 #include "Dynamic/smoothPositionSolver.h"
+#include "Dynamic/MassProperties.h"
 
 #include "algo/kdtree.h"
 #include "algo/kdtree.cpp"
@@ -23,23 +31,76 @@ namespace physE {
     {
     public:
         int sub_step = 1;
-        QVector<Object*> m_objects;
+        ObjectPool m_objects;
         std::vector<Solver*> m_solvers;
         QVector3D m_gravity = 2*QVector3D(0, -9.81f, 0);
         KDTree<QVector3D> tree;
-        void AddObject   (Object* object) {
-            m_objects.push_back(object);
+        impl::Broadphase m_broadphase;
+
+        // Trigger overlaps of the current and the previous step, sorted,
+        // and the events of the last Step for the application to read
+        std::vector<std::pair<Object*, Object*>> m_triggerOverlaps;
+        std::vector<std::pair<Object*, Object*>> m_prevTriggerOverlaps;
+        std::vector<TriggerEvent> m_triggerEvents;
+
+        bool m_stepping = false;
+
+        // Cloth contacts push dynamic bodies back with the opposite impulse
+        bool m_clothTwoWay = true;
+        // particles of the cloth by cell, only built when a body is near it
+        SpatialHash m_clothCells;
+        // body of every contact in cloth.contacts
+        std::vector<Object*> m_clothContactBodies;
+
+        // heap allocations during the last Step, needs WFPE_COUNT_ALLOCATIONS
+        quint64 m_stepAllocations = 0;
+
+        quint64 StepAllocations() const {
+            return m_stepAllocations;
+        }
+
+        const std::vector<TriggerEvent>& TriggerEvents() const {
+            return m_triggerEvents;
+        }
+        // Objects are built in place by the pool, args go to an Object constructor
+        template<typename... Args>
+        ObjectHandle AddObject(Args&&... args) {
+            m_broadphase.InvalidateQueries();
+            return m_objects.Create(std::forward<Args>(args)...);
+        }
+        Object* GetObject(ObjectHandle handle) const {
+            return m_objects.Get(handle);
+        }
+        // The handle dies at once, the object itself at the end of the
+        // current Step (or right away outside of one)
+        bool RemoveObject(ObjectHandle handle) {
+            if (!m_objects.Remove(handle)) return false;
+            if (!m_stepping) FlushRemoved();
+            return true;
         }
-        void RemoveObject(Object* object) { /* ... */ }
 
+        // The world owns its solvers
         void AddSolver   (Solver* solver) {
             m_solvers.push_back(solver);
         }
-        void RemoveSolver(Solver* solver) { /* ... */ }
+        void RemoveSolver(Solver* solver) {
+            auto it = std::find(m_solvers.begin(), m_solvers.end(), solver);
+            if (it == m_solvers.end()) return;
+            m_solvers.erase(it);
+            delete solver;
+        }
 
         physicalworld() : tree() {}
+        physicalworld(const physicalworld&) = delete;
+        physicalworld& operator = (const physicalworld&) = delete;
+
+        ~physicalworld() {
+            for (Solver* solver : m_solvers) {
+                delete solver;
+            }
+        }
 
-        Object * planeobject;
+        Object * planeobject = nullptr;
 
         Cloth cloth;
 
@@ -54,22 +115,9 @@ namespace physE {
             vertex.push_back(QVector3D(-1, 1, 1));
             vertex.push_back(QVector3D( 1,-1, 1));
             vertex.push_back(QVector3D(-1,-1, 1));
-            std::vector<int> face{
-                0,1,2,
-                1,2,3,
-                4,5,6,
-                5,6,7,
-                0,1,5,
-                0,4,5,
-                2,3,7,
-                2,6,7,
-                0,2,6,
-                0,6,4,
-                1,3,7,
-                1,5,7
-            };
             impl::HullCollider * hull = new impl::HullCollider();
-            hull->setData(vertex, face);
+            hull->setPoints(vertex);
+            MassProperties hullMass = impl::ComputeMassProperties(hull, 1.0f);
             srand((unsigned)time(NULL));
             for(int i = 0; i < 50; i++)
             {
@@ -79,16 +127,16 @@ namespace physE {
                 double vx = rand()%4-2;
                 double vy = rand()%4-2;
                 double vz = 0;//rand()%4-2;
-                Object *HullObj1 = new Object(i,QVector3D(x,y,z), QVector3D(vx,vy,vz), hull, true);
-                AddObject(HullObj1);
+                Object *HullObj1 = GetObject(AddObject(QVector3D(x,y,z), QVector3D(vx,vy,vz), hull, true));
+                HullObj1->SetMassProperties(hullMass);
             }
-            Object *HullObj1 = new Object(1,QVector3D(10,0,10), QVector3D(10,0,0), hull, true);
+            Object *HullObj1 = GetObject(AddObject(QVector3D(10,0,10), QVector3D(10,0,0), hull, true));
             //HullObj1->Transform->Rotation.rotate(10, 0, 0, 1);
-            AddObject(HullObj1);
-            Object *HullObj2 = new Object(2,QVector3D(30,0,10), QVector3D(-10,0,0), hull, true);
-            AddObject(HullObj2);
+            HullObj1->SetMassProperties(hullMass);
+            Object *HullObj2 = GetObject(AddObject(QVector3D(30,0,10), QVector3D(-10,0,0), hull, true));
+            HullObj2->SetMassProperties(hullMass);
             impl::PlaneCollider* pco = new impl::PlaneCollider(QVector3D(0,1,0), -50.0);
-            planeobject = new Object(-1, QVector3D(0,0,0), QVector3D(0, 0, 0), pco);
+            planeobject = GetObject(AddObject(QVector3D(0,0,0), QVector3D(0, 0, 0), pco));
             AddSolver(new ImpluseSolveer());
             //AddSolver((new SmoothPositionSolver()));
         }
@@ -97,47 +145,120 @@ namespace physE {
             float dt)
         {
             float sub_dt = dt/(float)sub_step;
+            const quint64 allocations = HeapAllocations();
+            FrameArena::BeginFrame();
+            m_stepping = true;
+            m_triggerOverlaps.clear();
             //qDebug()<<sub_dt;
             for(int i(sub_step); i--;)
             {
+                for (Object* obj : m_objects.Objects()) {
+                    if(obj->IsDynamic) obj->UpdateInertia();
+                }
+
                 ResolveCollisions(sub_dt);
 
-                for (Object* obj : qAsConst(m_objects)) {
+                for (Object* obj : m_objects.Objects()) {
+                    if(obj->IsKinematic) {
+                        Integrate(obj, sub_dt);
+                        continue;
+                    }
                     if(!obj->IsDynamic) continue;
                     obj->Force += obj->Mass * m_gravity; // apply a force
 
                     obj->Velocity += obj->Force / obj->Mass * sub_dt;
 
-                    obj->angularVelocity += obj->torque * (1.0f / obj->I) * sub_dt;
+                    obj->angularVelocity += obj->InvInertiaWorld.mapVector(obj->torque) * sub_dt;
 
                     float ang = obj->angularVelocity.length() * sub_dt;
 
-                    obj->Transform->Position += obj->Velocity * sub_dt;
+                    // rotate about the center of mass, not the collider origin
+                    QVector3D com = obj->WorldCenterOfMass() + obj->Velocity * sub_dt;
 
-                    obj->Transform->Rotation.rotate(ang*180/3.14f, obj->angularVelocity.normalized());
+                    QMatrix4x4 spin;
+                    spin.rotate(ang*180/3.14f, obj->angularVelocity.normalized());
+                    obj->Transform->Rotation = spin * obj->Transform->Rotation;
+
+                    obj->Transform->Position = com - obj->Transform->Rotation.mapVector(obj->CenterOfMass);
 
                     obj->Force = QVector3D(0, 0, 0); // reset net force at the end
                 }
-                cloth.update(sub_dt);
+                CollideCloth();
+                cloth.update(sub_dt, m_gravity);
+                PushBodiesFromCloth();
+
+            }
+            UpdateTriggerEvents();
+            m_stepping = false;
+            FlushRemoved();
+            m_broadphase.InvalidateQueries();
+            m_stepAllocations = HeapAllocations() - allocations;
+        }
+
+        // Kinematic bodies follow their velocities exactly, no gravity or forces
+        void Integrate(Object* obj, float dt)
+        {
+            obj->Transform->Position += obj->Velocity * dt;
 
+            float ang = obj->angularVelocity.length() * dt;
+            if (ang > 0) {
+                QVector3D com = obj->WorldCenterOfMass();
+                QMatrix4x4 spin;
+                spin.rotate(ang*180/3.14f, obj->angularVelocity.normalized());
+                obj->Transform->Rotation = spin * obj->Transform->Rotation;
+                obj->Transform->Position = com - obj->Transform->Rotation.mapVector(obj->CenterOfMass);
             }
         }
 
+        // Scene queries, against the state after the last Step. Directions
+        // need not be normalized, distances are in world units. Objects
+        // moved by hand since then are only seen after InvalidateQueries.
+        bool Raycast     (const QVector3D& origin, const QVector3D& direction, float maxDistance,
+                          RaycastHit& hit, const QueryFilter& filter = QueryFilter());
+        bool RaycastAny  (const QVector3D& origin, const QVector3D& direction, float maxDistance,
+                          const QueryFilter& filter = QueryFilter());
+        // all hits, nearest first
+        int  RaycastAll  (const QVector3D& origin, const QVector3D& direction, float maxDistance,
+                          std::vector<RaycastHit>& hits, const QueryFilter& filter = QueryFilter());
+        bool SphereCast  (const QVector3D& center, float radius, const QVector3D& direction, float maxDistance,
+                          RaycastHit& hit, const QueryFilter& filter = QueryFilter());
+        // shape must be convex, set filter.Ignore when it belongs to an object of the world
+        bool ShapeCast   (const Collider* shape, Transform* transform, const QVector3D& direction, float maxDistance,
+                          RaycastHit& hit, const QueryFilter& filter = QueryFilter());
+        int  OverlapAABB (const AABB& box, std::vector<Object*>& objects, const QueryFilter& filter = QueryFilter());
+        // closest hit of every ray, spread over the thread pool; misses have no Obj
+        void RaycastBatch(const std::vector<Ray>& rays, std::vector<RaycastHit>& hits,
+                          const QueryFilter& filter = QueryFilter());
+
+        void InvalidateQueries() {
+            m_broadphase.InvalidateQueries();
+        }
+
         void buildKDtree();
         void ResolveCollisions(float dt);
+        void CollideCloth();
+        void PushBodiesFromCloth();
+        void UpdateTriggerEvents();
+        void FlushRemoved();
 
         void Draw(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* shaderProgram)
         {
             shaderProgram->bind();
-            for(auto& obj : m_objects)
+            for(auto& obj : m_objects.Objects())
             {
                 obj->Draw(glFunc, shaderProgram);
             }
-            planeobject->Draw(glFunc, shaderProgram);
-            cloth.Draw(glFunc, shaderProgram);
             shaderProgram->release();
         }
 
+        // The cloth has its own program, it streams positions only
+        void DrawCloth(QOpenGLFunctions_3_3_Core* glFunc, QOpenGLShaderProgram* clothProgram)
+        {
+            clothProgram->bind();
+            cloth.Draw(glFunc, clothProgram);
+            clothProgram->release();
+        }
+
     };
 }
 
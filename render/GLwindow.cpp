@@ -54,6 +54,10 @@ void GLwindow::initializeGL()
     physicProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shader/blinePhong.vert");
     physicProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shader/blinePhong.frag");
     physicProgram.link();
+    clothProgram.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shader/cloth.vert");
+    clothProgram.addShaderFromSourceFile(QOpenGLShader::Geometry, ":/shader/cloth.geom");
+    clothProgram.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shader/blinePhong.frag");
+    clothProgram.link();
     physical.init();
 
     lastFrame = myGetTime();
@@ -91,6 +95,12 @@ void GLwindow::paintGL()
     physicProgram.setUniformValue("camPos", camera.GetPosition());
     physical.Draw(context()->versionFunctions<QOpenGLFunctions_3_3_Core>(), &physicProgram);
 
+    clothProgram.bind();
+    clothProgram.setUniformValue("view", view);
+    clothProgram.setUniformValue("projection", projection);
+    clothProgram.setUniformValue("camPos", camera.GetPosition());
+    physical.DrawCloth(context()->versionFunctions<QOpenGLFunctions_3_3_Core>(), &clothProgram);
+
     // 渲染结束
     //从多采样缓冲区传递数据到默认缓冲区
     // ---------
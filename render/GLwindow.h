@@ -53,6 +53,7 @@ private:
 
     physE::physicalworld physical;
     QOpenGLShaderProgram physicProgram;
+    QOpenGLShaderProgram clothProgram;
 
     // MSAA 抗锯齿*********************
     QOpenGLFramebufferObject *framebuffer;